@@ -22,6 +22,15 @@
 * - imtbase::IApplicationInfoController - Product configuration
 * - imtlic::IProductInfo - Feature/license management
 *
+* Internal helpers:
+* - CChangeCoalescer - Merges bursts of change notifications per collection
+* - CDatabaseExecutor - Database thread pool behind ExecuteDatabaseTask()
+* - CMetricsExporter - Prometheus text endpoint enabled by ServerConfig::metricsPort
+* - CRateLimiter - Per-client token buckets behind AdmitRequest()
+* - CSslFileWatcher - Triggers ReloadSsl() when certificate files are replaced
+* - CSubscriptionFanOut - Change notification delivery behind PublishChange()
+* - CTimerWheel - Heartbeat, idle and session expiry deadlines of the subscribers
+*
 * @section startup_sequence Server Startup Sequence
 *
 * 1. Apply connection parameters (host, ports)
@@ -39,8 +48,16 @@
 #include <AuthServerSdk/AuthServerSdk.h>
 
 
+// STL includes
+#include <atomic>
+
 // Qt includes
+#include <QtCore/QDeadlineTimer>
+#include <QtCore/QEventLoop>
 #include <QtCore/QFile>
+#include <QtCore/QTimer>
+#include <QtNetwork/QSslCertificate>
+#include <QtNetwork/QSslKey>
 
 // ACF includes
 #include <iauth/ILogin.h>
@@ -57,6 +74,11 @@
 #include <imtcom/ISslConfigurationApplier.h>
 
 // Local includes
+#include <AuthServerSdk/CDatabaseExecutor.h>
+#include <AuthServerSdk/CMetricsExporter.h>
+#include <AuthServerSdk/CRateLimiter.h>
+#include <AuthServerSdk/CSslFileWatcher.h>
+#include <AuthServerSdk/CSubscriptionFanOut.h>
 #include <GeneratedFiles/AuthServerSdk/CAuthServerSdk.h>
 
 
@@ -64,6 +86,9 @@ namespace AuthServerSdk
 {
 
 
+static const int s_drainCheckIntervalMs = 10;
+
+
 /**
 * @brief Internal implementation class for CAuthorizableServer.
 *
@@ -85,6 +110,10 @@ class CAuthorizableServerImpl
 {
 public:
 	CAuthorizableServerImpl()
+		:m_isStopping(false),
+		m_activeRequestCount(0),
+		m_sslFileWatcher([this](){ OnSslFilesChanged(); }),
+		m_metricsExporter([this](){ return FormatMetrics(); })
 	{
 		m_sdk.EnsureAutoInitComponentsCreated();
 	}
@@ -92,116 +121,126 @@ public:
 
 	bool Start(const ServerConfig& serverConfig)
 	{
-		imtcom::IServerDispatcher* serverControllerPtr = m_sdk.GetInterface<imtcom::IServerDispatcher>();
-		if (serverControllerPtr == nullptr){
-			qWarning() << "Server dispatcher interface is not available";
-			return false;
-		}
+		if (!StartInternal(serverConfig)){
+			// Listeners, timers and the metrics endpoint of the steps that succeeded
+			Stop();
 
-		if (!SetConnectionParam(serverConfig)){
-			qWarning() << "Failed to set connection parameters: HTTP" << serverConfig.httpPort << "WS" << serverConfig.wsPort;
 			return false;
 		}
 
-		if (serverConfig.sslConfig.has_value()){
-			const SslConfig& sslConfig = *serverConfig.sslConfig;
-			imtcom::ISslConfigurationApplier* sslConfigurationApplierPtr = m_sdk.GetInterface<imtcom::ISslConfigurationApplier>();
-			if (sslConfigurationApplierPtr == nullptr){
-				qWarning() << "SSL configuration applier interface is not available";
-				return false;
-			}
-
-			if (sslConfig.localCertificatePath.isEmpty() || sslConfig.privateKeyPath.isEmpty()){
-				qWarning() << "Local certificate or private key path is empty";
-				return false;
-			}
+		return true;
+	}
 
-			// Local certificate
-			if (!sslConfigurationApplierPtr->LoadLocalCertificateFromFile(
-					sslConfig.localCertificatePath, sslConfig.localCertificateFormat)){
-				qWarning() << "Failed to load local certificate from" << sslConfig.localCertificatePath;
-				return false;
-			}
-			qDebug() << "Loaded local certificate from" << sslConfig.localCertificatePath;
-
-			// CA certificates
-			if (!sslConfig.caCertificatePaths.isEmpty()){
-				for (const QString& certPath : sslConfig.caCertificatePaths){
-					if (!sslConfigurationApplierPtr->LoadCaCertificatesFromFile(certPath, sslConfig.caCertificateFormat)){
-						qWarning() << "Failed to load CA certificate from" << certPath;
-						return false;
-					}
-					qDebug() << "Loaded CA certificate from" << certPath;
-				}
-			}
-			else{
-				qDebug() << "No CA certificates specified";
-			}
 
-			// Private key
-			if (!sslConfigurationApplierPtr->LoadPrivateKeyFromFile(
-					sslConfig.privateKeyPath,
-					sslConfig.privateKeyAlgorithm,
-					sslConfig.privateKeyFormat,
-					sslConfig.privateKeyPassPhrase)){
-				qWarning() << "Failed to load private key from" << sslConfig.privateKeyPath;
-				return false;
-			}
-			qDebug() << "Loaded private key from" << sslConfig.privateKeyPath;
+	bool Stop()
+	{
+		imtcom::IServerDispatcher* serverControllerPtr = m_sdk.GetInterface<imtcom::IServerDispatcher>();
+		if (serverControllerPtr == nullptr){
+			qWarning() << "Server dispatcher interface is not available";
+			return false;
+		}
 
-			// SSL protocol
-			if (!sslConfigurationApplierPtr->SetSslProtocol(sslConfig.protocol)){
-				qWarning() << "Failed to set SSL protocol:" << sslConfig.protocol;
-				return false;
-			}
-			qDebug() << "SSL protocol set to" << sslConfig.protocol;
+		m_isStopping.store(true);
 
-			// Peer verify mode
-			if (!sslConfigurationApplierPtr->SetPeerVerifyMode(sslConfig.verifyMode)){
-				qWarning() << "Failed to set peer verify mode:" << sslConfig.verifyMode;
-				return false;
-			}
-			qDebug() << "Peer verify mode set to" << static_cast<int>(sslConfig.verifyMode);
-		}
+		m_sslFileWatcher.SetFilePaths(QStringList());
+		m_metricsExporter.Stop();
+		m_subscriptionFanOut.DetachAll();
 
-		if (!serverControllerPtr->StartServer(imtcom::IServerConnectionInterface::PT_HTTP)){
-			qWarning() << "Failed to start HTTP server on port" << serverConfig.httpPort;
+		if (!serverControllerPtr->StopServer(imtcom::IServerConnectionInterface::PT_HTTP)){
 			return false;
 		}
-		qDebug() << "HTTP server started on port" << serverConfig.httpPort;
 
-		if (!serverControllerPtr->StartServer(imtcom::IServerConnectionInterface::PT_WEBSOCKET)){
-			qWarning() << "Failed to start WebSocket server on port" << serverConfig.wsPort;
+		if (!serverControllerPtr->StopServer(imtcom::IServerConnectionInterface::PT_WEBSOCKET)){
 			return false;
 		}
-		qDebug() << "WebSocket server started on port" << serverConfig.wsPort;
 
-		qDebug() << "Server started successfully";
+		// Listeners are closed, let the already accepted database work finish
+		m_databaseExecutor.WaitForDone();
 
 		return true;
 	}
 
 
-	bool Stop()
+	bool Stop(int drainTimeoutMs)
 	{
+		if (drainTimeoutMs <= 0){
+			return Stop();
+		}
+
 		imtcom::IServerDispatcher* serverControllerPtr = m_sdk.GetInterface<imtcom::IServerDispatcher>();
 		if (serverControllerPtr == nullptr){
 			qWarning() << "Server dispatcher interface is not available";
 			return false;
 		}
 
+		// New requests are refused from here on
+		m_isStopping.store(true);
+
+		m_sslFileWatcher.SetFilePaths(QStringList());
+		m_metricsExporter.Stop();
+
+		QDeadlineTimer deadline(drainTimeoutMs);
+
+		// The listener stays open until the responses of the running requests are written
+		if (!WaitUntil([this](){ return (m_activeRequestCount.load() == 0) && m_databaseExecutor.WaitForDone(0); }, deadline)){
+			qWarning() << "Drain timeout expired with" << m_activeRequestCount.load() << "requests still running";
+		}
+
 		if (!serverControllerPtr->StopServer(imtcom::IServerConnectionInterface::PT_HTTP)){
 			return false;
 		}
 
+		// Changes published by the drained requests reach the subscribers before they are closed
+		m_subscriptionFanOut.FlushPending();
+		QDeadlineTimer flushDeadline(deadline.remainingTime() / 2);
+		if (!WaitUntil([this](){ return !m_subscriptionFanOut.HasPendingMessages(); }, flushDeadline)){
+			qWarning() << "Drain timeout expired with change notifications still queued";
+		}
+
+		// Spread the reconnects of the clients over the rest of the window, keeping time for the close handshakes
+		int closeWindowMs = int(deadline.remainingTime() * 3 / 4);
+		m_subscriptionFanOut.CloseAll(closeWindowMs);
+		WaitUntil([this](){ return m_subscriptionFanOut.GetSubscriberCount() == 0; }, deadline);
+
+		// Subscribers that did not answer the close frame in time
+		m_subscriptionFanOut.DetachAll();
+
 		if (!serverControllerPtr->StopServer(imtcom::IServerConnectionInterface::PT_WEBSOCKET)){
 			return false;
 		}
 
+		// Queued queries are canceled, their callbacks are still delivered
+		if (!m_databaseExecutor.WaitForDone(qMax(0, int(deadline.remainingTime())))){
+			m_databaseExecutor.ClearQueue();
+			m_databaseExecutor.WaitForDone();
+		}
+
+		qDebug() << "Server drained and stopped in" << (drainTimeoutMs - qMax(qint64(0), deadline.remainingTime())) << "ms";
+
+		return true;
+	}
+
+
+	bool BeginRequest()
+	{
+		m_activeRequestCount.fetch_add(1);
+
+		// Checked after counting, so a draining Stop() either sees the request or it is refused
+		if (m_isStopping.load()){
+			m_activeRequestCount.fetch_sub(1);
+			return false;
+		}
+
 		return true;
 	}
 
 
+	void EndRequest()
+	{
+		m_activeRequestCount.fetch_sub(1);
+	}
+
+
 	bool SetFeaturesFilePath(const QString& filePath)
 	{
 		imtlic::IProductInfo* productInfoPtr = m_sdk.GetInterface<imtlic::IProductInfo>();
@@ -251,7 +290,381 @@ public:
 		return true;
 	}
 
-private:
+
+	bool ReloadSsl(const SslConfig& sslConfig)
+	{
+		if (!ValidateSslFiles(sslConfig)){
+			qWarning() << "SSL reload rejected, the previous certificates stay in use";
+			return false;
+		}
+
+		if (!ApplySslConfig(sslConfig)){
+			qWarning() << "Failed to apply the reloaded SSL configuration";
+			return false;
+		}
+
+		if (sslConfig.reloadOnFileChange){
+			m_activeSslConfig = sslConfig;
+			QStringList filePaths = GetSslFilePaths(sslConfig);
+			if (filePaths != m_sslFileWatcher.GetFilePaths()){
+				m_sslFileWatcher.SetFilePaths(filePaths);
+			}
+		}
+		else{
+			m_sslFileWatcher.SetFilePaths(QStringList());
+		}
+
+		qDebug() << "SSL configuration reloaded from" << sslConfig.localCertificatePath;
+
+		return true;
+	}
+
+
+	bool AdmitRequest(const QList<QByteArray>& clientKeys, RequestCost cost)
+	{
+		return m_rateLimiter.Admit(clientKeys, cost);
+	}
+
+
+	qint64 AttachSubscriber(QWebSocket* socketPtr, const SubscriberContext& context)
+	{
+		return m_subscriptionFanOut.AttachSubscriber(socketPtr, context);
+	}
+
+
+	bool UpdateSubscriberContext(qint64 subscriberId, const SubscriberContext& context)
+	{
+		return m_subscriptionFanOut.UpdateSubscriberContext(subscriberId, context);
+	}
+
+
+	void DetachSubscriber(qint64 subscriberId)
+	{
+		m_subscriptionFanOut.DetachSubscriber(subscriberId);
+	}
+
+
+	void PublishChange(const ChangeNotification& notification)
+	{
+		m_subscriptionFanOut.Publish(notification);
+	}
+
+
+	bool ExecuteDatabaseTask(const DatabaseTask& task, QObject* contextPtr, const DatabaseTaskCallback& callback, int deadlineMs)
+	{
+		return m_databaseExecutor.Submit(task, contextPtr, callback, deadlineMs);
+	}
+
+
+	ServerStatistics GetStatistics() const
+	{
+		ServerStatistics statistics;
+
+		m_databaseExecutor.GetStatistics(statistics);
+		m_rateLimiter.GetStatistics(statistics);
+		m_subscriptionFanOut.GetStatistics(statistics);
+
+		statistics.activeRequests = m_activeRequestCount.load(std::memory_order_relaxed);
+
+		return statistics;
+	}
+
+
+	/**
+	* @brief Applies certificate, key and TLS parameters to the listeners.
+	*
+	* Used by Start() and by ReloadSsl(). The listeners are not restarted,
+	* the applier replaces the material used for subsequent handshakes.
+	*/
+	bool ApplySslConfig(const SslConfig& sslConfig)
+	{
+		imtcom::ISslConfigurationApplier* sslConfigurationApplierPtr = m_sdk.GetInterface<imtcom::ISslConfigurationApplier>();
+		if (sslConfigurationApplierPtr == nullptr){
+			qWarning() << "SSL configuration applier interface is not available";
+			return false;
+		}
+
+		if (sslConfig.localCertificatePath.isEmpty() || sslConfig.privateKeyPath.isEmpty()){
+			qWarning() << "Local certificate or private key path is empty";
+			return false;
+		}
+
+		// Local certificate
+		if (!sslConfigurationApplierPtr->LoadLocalCertificateFromFile(
+				sslConfig.localCertificatePath, sslConfig.localCertificateFormat)){
+			qWarning() << "Failed to load local certificate from" << sslConfig.localCertificatePath;
+			return false;
+		}
+		qDebug() << "Loaded local certificate from" << sslConfig.localCertificatePath;
+
+		// CA certificates
+		if (!sslConfig.caCertificatePaths.isEmpty()){
+			for (const QString& certPath : sslConfig.caCertificatePaths){
+				if (!sslConfigurationApplierPtr->LoadCaCertificatesFromFile(certPath, sslConfig.caCertificateFormat)){
+					qWarning() << "Failed to load CA certificate from" << certPath;
+					return false;
+				}
+				qDebug() << "Loaded CA certificate from" << certPath;
+			}
+		}
+		else{
+			qDebug() << "No CA certificates specified";
+		}
+
+		// Private key
+		if (!sslConfigurationApplierPtr->LoadPrivateKeyFromFile(
+				sslConfig.privateKeyPath,
+				sslConfig.privateKeyAlgorithm,
+				sslConfig.privateKeyFormat,
+				sslConfig.privateKeyPassPhrase)){
+			qWarning() << "Failed to load private key from" << sslConfig.privateKeyPath;
+			return false;
+		}
+		qDebug() << "Loaded private key from" << sslConfig.privateKeyPath;
+
+		// SSL protocol
+		if (!sslConfigurationApplierPtr->SetSslProtocol(sslConfig.protocol)){
+			qWarning() << "Failed to set SSL protocol:" << sslConfig.protocol;
+			return false;
+		}
+		qDebug() << "SSL protocol set to" << sslConfig.protocol;
+
+		// Peer verify mode
+		if (!sslConfigurationApplierPtr->SetPeerVerifyMode(sslConfig.verifyMode)){
+			qWarning() << "Failed to set peer verify mode:" << sslConfig.verifyMode;
+			return false;
+		}
+		qDebug() << "Peer verify mode set to" << static_cast<int>(sslConfig.verifyMode);
+
+		return true;
+	}
+
+
+	static void AppendMetric(QByteArray& output, const QByteArray& name, const QByteArray& type, const QByteArray& help, double value)
+	{
+		output.append("# HELP ").append(name).append(' ').append(help).append('\n');
+		output.append("# TYPE ").append(name).append(' ').append(type).append('\n');
+		output.append(name).append(' ').append(QByteArray::number(value, 'g', 12)).append('\n');
+	}
+
+
+	/**
+	* @brief Builds the Prometheus text exposition of the server statistics.
+	*
+	* Called on every scrape of the metrics endpoint.
+	*/
+	QByteArray FormatMetrics() const
+	{
+		ServerStatistics statistics = GetStatistics();
+
+		QByteArray output;
+		AppendMetric(output, "authserver_database_threads", "gauge", "Configured database threads.", statistics.databaseThreads);
+		AppendMetric(output, "authserver_database_tasks_active", "gauge", "Database tasks currently running.", statistics.activeDatabaseTasks);
+		AppendMetric(output, "authserver_database_queue_depth", "gauge", "Database tasks waiting for a free thread.", statistics.databaseQueueDepth);
+		AppendMetric(output, "authserver_database_tasks_completed_total", "counter", "Database tasks that have run.", statistics.completedDatabaseTasks);
+		AppendMetric(output, "authserver_database_tasks_rejected_total", "counter", "Database tasks rejected because the queue was full.", statistics.rejectedDatabaseTasks);
+		AppendMetric(output, "authserver_database_tasks_expired_total", "counter", "Database tasks skipped because their deadline passed in the queue.", statistics.expiredDatabaseTasks);
+		AppendMetric(output, "authserver_database_tasks_canceled_total", "counter", "Queued database tasks canceled on stop.", statistics.canceledDatabaseTasks);
+		AppendMetric(output, "authserver_database_queue_wait_seconds_avg", "gauge", "Average time a database task waited in the queue.", statistics.averageDatabaseQueueWaitMs / 1000.0);
+		AppendMetric(output, "authserver_database_queue_wait_seconds_max", "gauge", "Longest time a database task waited in the queue.", statistics.maxDatabaseQueueWaitMs / 1000.0);
+		AppendMetric(output, "authserver_database_task_seconds_avg", "gauge", "Average execution time of a database task.", statistics.averageDatabaseTaskMs / 1000.0);
+		AppendMetric(output, "authserver_database_task_seconds_max", "gauge", "Longest execution time of a database task.", statistics.maxDatabaseTaskMs / 1000.0);
+		AppendMetric(output, "authserver_requests_admitted_total", "counter", "Requests admitted by the rate limiter.", statistics.admittedRequests);
+		AppendMetric(output, "authserver_requests_rate_limited_total", "counter", "Requests rejected by the rate limiter.", statistics.rateLimitedRequests);
+		AppendMetric(output, "authserver_subscribers", "gauge", "WebSocket connections receiving change notifications.", statistics.subscribers);
+		AppendMetric(output, "authserver_changes_published_total", "counter", "Change notifications published.", statistics.publishedChanges);
+		AppendMetric(output, "authserver_notifications_delivered_total", "counter", "Notification messages written to subscribers.", statistics.deliveredNotifications);
+		AppendMetric(output, "authserver_subscriber_queue_high_water", "gauge", "Longest send queue of a notification subscriber.", statistics.subscriberQueueHighWaterMark);
+		AppendMetric(output, "authserver_notifications_dropped_total", "counter", "Notification messages discarded for slow subscribers.", statistics.droppedNotifications);
+		AppendMetric(output, "authserver_resync_requests_total", "counter", "Resync events sent after a send queue overflow.", statistics.resyncRequests);
+		AppendMetric(output, "authserver_slow_subscribers_disconnected_total", "counter", "Subscribers disconnected because their send queue overflowed.", statistics.disconnectedSlowSubscribers);
+		AppendMetric(output, "authserver_changes_coalesced_total", "counter", "Changes merged into a pending notification batch.", statistics.coalescedChanges);
+		AppendMetric(output, "authserver_heartbeats_sent_total", "counter", "Pings sent to silent notification subscribers.", statistics.heartbeatsSent);
+		AppendMetric(output, "authserver_idle_subscribers_closed_total", "counter", "Subscribers closed after the idle timeout.", statistics.idleSubscribersClosed);
+		AppendMetric(output, "authserver_expired_subscriber_sessions_total", "counter", "Subscribers closed because their session expired.", statistics.expiredSubscriberSessions);
+		AppendMetric(output, "authserver_timer_tick_max_seconds", "gauge", "Longest processing time of a subscriber timer tick.", statistics.maxTimerTickMs / 1000.0);
+
+		output.append("# HELP authserver_fanout_latency_seconds Time until a sender thread has written a notification to its subscribers.\n");
+		output.append("# TYPE authserver_fanout_latency_seconds gauge\n");
+		output.append("authserver_fanout_latency_seconds{quantile=\"0.5\"} ").append(QByteArray::number(statistics.fanOutLatencyP50Ms / 1000.0, 'g', 12)).append('\n');
+		output.append("authserver_fanout_latency_seconds{quantile=\"0.95\"} ").append(QByteArray::number(statistics.fanOutLatencyP95Ms / 1000.0, 'g', 12)).append('\n');
+		output.append("authserver_fanout_latency_seconds{quantile=\"0.99\"} ").append(QByteArray::number(statistics.fanOutLatencyP99Ms / 1000.0, 'g', 12)).append('\n');
+
+		return output;
+	}
+
+
+	/**
+	* @brief Runs a local event loop until a condition is met or the deadline expires.
+	*
+	* Network I/O of the listeners is driven by the event loop of the calling
+	* thread, blocking it would stall the responses that are being drained.
+	* The condition is checked on a timer; user input events are not processed.
+	*/
+	template<typename Condition>
+	static bool WaitUntil(const Condition& condition, const QDeadlineTimer& deadline)
+	{
+		if (condition()){
+			return true;
+		}
+
+		QEventLoop eventLoop;
+
+		QTimer checkTimer;
+		QObject::connect(&checkTimer, &QTimer::timeout, &eventLoop, [&eventLoop, &condition](){
+			if (condition()){
+				eventLoop.quit();
+			}
+		});
+		checkTimer.start(s_drainCheckIntervalMs);
+
+		QTimer deadlineTimer;
+		deadlineTimer.setSingleShot(true);
+		QObject::connect(&deadlineTimer, &QTimer::timeout, &eventLoop, &QEventLoop::quit);
+		deadlineTimer.start(int(qMax(qint64(0), deadline.remainingTime())));
+
+		eventLoop.exec(QEventLoop::ExcludeUserInputEvents);
+
+		return condition();
+	}
+
+
+	/**
+	* @brief Checks that certificate and key files can be parsed.
+	*
+	* Performed before anything is handed to the applier, so that a
+	* half-written or mismatched file set never replaces working material.
+	*/
+	static bool ValidateSslFiles(const SslConfig& sslConfig)
+	{
+		if (sslConfig.localCertificatePath.isEmpty() || sslConfig.privateKeyPath.isEmpty()){
+			qWarning() << "Local certificate or private key path is empty";
+			return false;
+		}
+
+		QList<QSslCertificate> localCertificates = QSslCertificate::fromPath(sslConfig.localCertificatePath, sslConfig.localCertificateFormat);
+		if (localCertificates.isEmpty() || localCertificates.first().isNull()){
+			qWarning() << "No valid local certificate in" << sslConfig.localCertificatePath;
+			return false;
+		}
+
+		for (const QString& certPath : sslConfig.caCertificatePaths){
+			if (QSslCertificate::fromPath(certPath, sslConfig.caCertificateFormat).isEmpty()){
+				qWarning() << "No valid CA certificate in" << certPath;
+				return false;
+			}
+		}
+
+		QFile keyFile(sslConfig.privateKeyPath);
+		if (!keyFile.open(QIODevice::ReadOnly)){
+			qWarning() << "Unable to open private key file" << sslConfig.privateKeyPath;
+			return false;
+		}
+
+		QSslKey privateKey(&keyFile, sslConfig.privateKeyAlgorithm, sslConfig.privateKeyFormat, QSsl::PrivateKey, sslConfig.privateKeyPassPhrase);
+		if (privateKey.isNull()){
+			qWarning() << "No valid private key in" << sslConfig.privateKeyPath;
+			return false;
+		}
+
+		if (localCertificates.first().publicKey().algorithm() != privateKey.algorithm()){
+			qWarning() << "Private key algorithm does not match the local certificate";
+			return false;
+		}
+
+		return true;
+	}
+
+
+	static QStringList GetSslFilePaths(const SslConfig& sslConfig)
+	{
+		QStringList filePaths;
+		filePaths << sslConfig.localCertificatePath << sslConfig.privateKeyPath << sslConfig.caCertificatePaths;
+
+		return filePaths;
+	}
+
+
+	void OnSslFilesChanged()
+	{
+		qDebug() << "SSL files changed, reloading certificates";
+
+		if (!ReloadSsl(m_activeSslConfig)){
+			qWarning() << "Automatic SSL reload failed, the previous certificates stay in use";
+		}
+	}
+
+
+	/**
+	* @brief Runs the startup steps of Start(), stops at the first failing one.
+	*/
+	bool StartInternal(const ServerConfig& serverConfig)
+	{
+		m_isStopping.store(false);
+
+		imtcom::IServerDispatcher* serverControllerPtr = m_sdk.GetInterface<imtcom::IServerDispatcher>();
+		if (serverControllerPtr == nullptr){
+			qWarning() << "Server dispatcher interface is not available";
+			return false;
+		}
+
+		if (!SetConnectionParam(serverConfig)){
+			qWarning() << "Failed to set connection parameters: HTTP" << serverConfig.httpPort << "WS" << serverConfig.wsPort;
+			return false;
+		}
+
+		m_databaseExecutor.Configure(serverConfig.databaseExecutor);
+
+		ServerStatistics poolInfo;
+		m_databaseExecutor.GetStatistics(poolInfo);
+		qDebug() << "Database executor configured with" << poolInfo.databaseThreads << "threads, queue limit" << serverConfig.databaseExecutor.maxQueueDepth;
+
+		m_rateLimiter.Configure(serverConfig.rateLimit);
+		m_subscriptionFanOut.Configure(serverConfig.notifications);
+
+		if (serverConfig.rateLimit.enabled){
+			qDebug() << "Rate limiting enabled:" << serverConfig.rateLimit.cheapRequestsPerSecond << "cheap and"
+						<< serverConfig.rateLimit.expensiveRequestsPerSecond << "expensive requests per second and key";
+		}
+
+		if (serverConfig.sslConfig.has_value()){
+			if (!ApplySslConfig(*serverConfig.sslConfig)){
+				return false;
+			}
+		}
+
+		if (!serverControllerPtr->StartServer(imtcom::IServerConnectionInterface::PT_HTTP)){
+			qWarning() << "Failed to start HTTP server on port" << serverConfig.httpPort;
+			return false;
+		}
+		qDebug() << "HTTP server started on port" << serverConfig.httpPort;
+
+		if (!serverControllerPtr->StartServer(imtcom::IServerConnectionInterface::PT_WEBSOCKET)){
+			qWarning() << "Failed to start WebSocket server on port" << serverConfig.wsPort;
+			return false;
+		}
+		qDebug() << "WebSocket server started on port" << serverConfig.wsPort;
+
+		m_metricsExporter.Stop();
+		if (serverConfig.metricsPort > 0){
+			if (!m_metricsExporter.Start(serverConfig.metricsHost, serverConfig.metricsPort)){
+				return false;
+			}
+		}
+
+		// Only watch the certificate files while the listeners are secure
+		m_sslFileWatcher.SetFilePaths(QStringList());
+		if (serverConfig.sslConfig.has_value() && serverConfig.sslConfig->reloadOnFileChange){
+			m_activeSslConfig = *serverConfig.sslConfig;
+			m_sslFileWatcher.SetFilePaths(GetSslFilePaths(m_activeSslConfig));
+		}
+
+		qDebug() << "Server started successfully";
+
+		return true;
+	}
+
+
 	/**
 	* @brief Helper method to configure connection parameters.
 	*
@@ -292,6 +705,38 @@ private:
 	* during construction to ensure availability of server infrastructure.
 	*/
 	mutable CAuthServerSdk m_sdk;
+
+	/**
+	* @brief Set by Stop(), BeginRequest() refuses requests until the next Start().
+	*/
+	std::atomic<bool> m_isStopping;
+	std::atomic<int> m_activeRequestCount;
+
+	/**
+	* @brief Database thread pool, sized from ServerConfig::databaseExecutor on every Start().
+	*/
+	CDatabaseExecutor m_databaseExecutor;
+
+	/**
+	* @brief Per-client token buckets, configured from ServerConfig::rateLimit on every Start().
+	*/
+	CRateLimiter m_rateLimiter;
+
+	/**
+	* @brief Watches the active certificate files when SslConfig::reloadOnFileChange is set.
+	*/
+	CSslFileWatcher m_sslFileWatcher;
+	SslConfig m_activeSslConfig;
+
+	/**
+	* @brief Serves FormatMetrics() when ServerConfig::metricsPort is set.
+	*/
+	CMetricsExporter m_metricsExporter;
+
+	/**
+	* @brief Sender threads delivering PublishChange() to the attached subscribers.
+	*/
+	CSubscriptionFanOut m_subscriptionFanOut;
 };
 
 
@@ -337,6 +782,16 @@ bool CAuthorizableServer::Stop() const
 }
 
 
+bool CAuthorizableServer::Stop(int drainTimeoutMs) const
+{
+	if (m_implPtr != nullptr){
+		return m_implPtr->Stop(drainTimeoutMs);
+	}
+
+	return false;
+}
+
+
 bool CAuthorizableServer::SetFeaturesFilePath(const QString& filePath) const
 {
 	if (m_implPtr != nullptr){
@@ -367,6 +822,100 @@ bool CAuthorizableServer::SetProductId(const QByteArray& productId) const
 }
 
 
+bool CAuthorizableServer::ReloadSsl(const SslConfig& sslConfig) const
+{
+	if (m_implPtr != nullptr){
+		return m_implPtr->ReloadSsl(sslConfig);
+	}
+
+	return false;
+}
+
+
+bool CAuthorizableServer::BeginRequest() const
+{
+	if (m_implPtr != nullptr){
+		return m_implPtr->BeginRequest();
+	}
+
+	return false;
+}
+
+
+void CAuthorizableServer::EndRequest() const
+{
+	if (m_implPtr != nullptr){
+		m_implPtr->EndRequest();
+	}
+}
+
+
+bool CAuthorizableServer::AdmitRequest(const QList<QByteArray>& clientKeys, RequestCost cost) const
+{
+	if (m_implPtr != nullptr){
+		return m_implPtr->AdmitRequest(clientKeys, cost);
+	}
+
+	return false;
+}
+
+
+qint64 CAuthorizableServer::AttachSubscriber(QWebSocket* socketPtr, const SubscriberContext& context) const
+{
+	if (m_implPtr != nullptr){
+		return m_implPtr->AttachSubscriber(socketPtr, context);
+	}
+
+	return -1;
+}
+
+
+bool CAuthorizableServer::UpdateSubscriberContext(qint64 subscriberId, const SubscriberContext& context) const
+{
+	if (m_implPtr != nullptr){
+		return m_implPtr->UpdateSubscriberContext(subscriberId, context);
+	}
+
+	return false;
+}
+
+
+void CAuthorizableServer::DetachSubscriber(qint64 subscriberId) const
+{
+	if (m_implPtr != nullptr){
+		m_implPtr->DetachSubscriber(subscriberId);
+	}
+}
+
+
+void CAuthorizableServer::PublishChange(const ChangeNotification& notification) const
+{
+	if (m_implPtr != nullptr){
+		m_implPtr->PublishChange(notification);
+	}
+}
+
+
+bool CAuthorizableServer::ExecuteDatabaseTask(const DatabaseTask& task, QObject* contextPtr, const DatabaseTaskCallback& callback, int deadlineMs) const
+{
+	if (m_implPtr != nullptr){
+		return m_implPtr->ExecuteDatabaseTask(task, contextPtr, callback, deadlineMs);
+	}
+
+	return false;
+}
+
+
+ServerStatistics CAuthorizableServer::GetStatistics() const
+{
+	if (m_implPtr != nullptr){
+		return m_implPtr->GetStatistics();
+	}
+
+	return ServerStatistics();
+}
+
+
 } // namespace AuthServerSdk
 
 
@@ -83,15 +83,22 @@
 
 
 // STL includes
+#include <functional>
 #include <optional>
 
 // Qt includes
 #include <QtCore/QString>
 #include <QtCore/QByteArray>
+#include <QtCore/QByteArrayList>
+#include <QtCore/QDateTime>
+#include <QtCore/QDeadlineTimer>
 #include <QtNetwork/QSslConfiguration>
 #include <QtNetwork/QSslSocket>
 
 
+class QWebSocket;
+
+
 namespace AuthServerSdk
 {
 
@@ -274,6 +281,417 @@ struct SslConfig
 	*       be supported by older clients.
 	*/
 	QSsl::SslProtocol protocol = QSsl::TlsV1_2;
+
+	/**
+	* @brief Reload the certificate files automatically when they change.
+	*
+	* When enabled, the server watches the local certificate, private key
+	* and CA certificate files and calls CAuthorizableServer::ReloadSsl()
+	* with this configuration once the files have been replaced (for
+	* example by a certificate renewal job). Default is false.
+	*
+	* @note Changes are applied after a short settle delay so that a
+	*       certificate and its key written one after another are picked
+	*       up together. Files that do not parse are ignored and the
+	*       previous material stays in use.
+	*/
+	bool reloadOnFileChange = false;
+};
+
+
+/**
+* @brief Database executor configuration.
+*
+* Database work handed to CAuthorizableServer::ExecuteDatabaseTask() runs
+* on a pool of its own, so slow queries do not occupy the network threads.
+* Each thread keeps its database connection, so the
+* thread count is also the number of concurrent queries.
+*
+* @see ServerConfig, ServerStatistics
+*/
+struct DatabaseExecutorConfig
+{
+	/**
+	* @brief Number of database threads.
+	*
+	* A value of 0 (default) selects the number of CPU cores, at least 2
+	* and at most 16.
+	*/
+	int threads = 0;
+
+	/**
+	* @brief Maximum number of queued database tasks.
+	*
+	* When the limit is reached, new tasks are rejected immediately. A value
+	* of 0 (default) disables the limit.
+	*/
+	int maxQueueDepth = 0;
+
+	/**
+	* @brief Deadline of tasks submitted without one, in milliseconds.
+	*
+	* 0 (default) lets such tasks wait without limit.
+	*/
+	int defaultDeadlineMs = 0;
+};
+
+
+/**
+* @brief Outcome of a database task, passed to its callback.
+*
+* @see CAuthorizableServer::ExecuteDatabaseTask()
+*/
+enum class DatabaseTaskStatus
+{
+	/** @brief The task has run. */
+	Completed,
+
+	/** @brief The deadline passed while the task was queued; it has not run. */
+	DeadlineExceeded,
+
+	/** @brief The task was removed from the queue when the server stopped. */
+	Canceled
+};
+
+
+/**
+* @brief Database work executed on the database executor.
+*
+* Receives the deadline of the request, e.g. to limit the statement timeout
+* of its query.
+*/
+typedef std::function<void(const QDeadlineTimer& deadline)> DatabaseTask;
+
+/**
+* @brief Continuation of a database task.
+*/
+typedef std::function<void(DatabaseTaskStatus status)> DatabaseTaskCallback;
+
+
+/**
+* @brief Cost class of a request for rate limiting.
+*
+* @see RateLimitConfig, CAuthorizableServer::AdmitRequest()
+*/
+enum class RequestCost
+{
+	/** @brief Lookups of single objects, token refresh and similar requests. */
+	Cheap,
+
+	/** @brief Requests that scan collections, e.g. user, role, group or tenant lists. */
+	Expensive
+};
+
+
+/**
+* @brief Per-client rate limiting configuration.
+*
+* Every client key (user, tenant, personal access token, address) gets a
+* token bucket for cheap and one for expensive requests. A bucket holds up
+* to its burst size and is refilled continuously at its rate. Requests of a
+* client that has used up its budget are rejected immediately instead of
+* waiting for a worker.
+*
+* @see CAuthorizableServer::AdmitRequest()
+*/
+struct RateLimitConfig
+{
+	/** @brief Enables the limiter. Default is false (every request is admitted). */
+	bool enabled = false;
+
+	/** @brief Sustained rate of cheap requests per key and second. */
+	double cheapRequestsPerSecond = 50.0;
+
+	/** @brief Number of cheap requests a key may send at once. */
+	int cheapBurst = 100;
+
+	/** @brief Sustained rate of expensive requests per key and second. */
+	double expensiveRequestsPerSecond = 2.0;
+
+	/** @brief Number of expensive requests a key may send at once. */
+	int expensiveBurst = 10;
+
+	/**
+	* @brief Upper bound of tracked keys.
+	*
+	* When reached, keys whose buckets are full again are forgotten.
+	*/
+	int maxTrackedKeys = 100000;
+};
+
+
+/**
+* @brief What happens when the send queue of a notification subscriber is full.
+*
+* @see NotificationConfig::slowConsumerPolicy
+*/
+enum class SlowConsumerPolicy
+{
+	/**
+	* @brief Discard the queued notifications and send a single
+	*        `{"type":"resync"}` message instead.
+	*
+	* The client reloads the data it displays. Notifications published until
+	* the resync message is sent are discarded, the reload covers them.
+	*/
+	ResyncRequired,
+
+	/** @brief Discard the oldest queued notification. */
+	DropOldest,
+
+	/** @brief Close the connection; the client reconnects and reloads. */
+	Disconnect
+};
+
+
+/**
+* @brief Change notification fan-out configuration.
+*
+* @see CAuthorizableServer::PublishChange()
+*/
+struct NotificationConfig
+{
+	/**
+	* @brief Number of threads writing notifications to the subscribers.
+	*
+	* Subscribers are distributed over the threads, each thread writes a
+	* notification to its subscribers in one batch. 0 selects the CPU core
+	* count, at most 8. Changes take effect on the next Start() while no
+	* subscriber is attached.
+	*/
+	int senderThreads = 0;
+
+	/**
+	* @brief Notifications queued per subscriber before slowConsumerPolicy applies.
+	*
+	* Messages are only handed to the socket while less than
+	* maxBytesInFlight are unsent, the rest waits in this queue. Default is 256.
+	*/
+	int maxQueuedNotifications = 256;
+
+	/** @brief Unsent bytes per subscriber socket before messages are queued. Default is 64 KiB. */
+	int maxBytesInFlight = 64 * 1024;
+
+	/** @brief Handling of subscribers whose queue is full. Default is ResyncRequired. */
+	SlowConsumerPolicy slowConsumerPolicy = SlowConsumerPolicy::ResyncRequired;
+
+	/**
+	* @brief Quiet period that closes a batch of changes, in milliseconds.
+	*
+	* Changes with the same collection, tenant and required permission are
+	* merged; repeated changes of an object keep only the latest operation.
+	* The batch is sent once no further change has arrived for this period.
+	* 0 (default) sends every change immediately.
+	*/
+	int coalescingWindowMs = 0;
+
+	/**
+	* @brief Longest delay of a batch after its first change, in milliseconds.
+	*
+	* Bounds the delay while changes keep arriving. Default is 1000.
+	*/
+	int maxCoalescingDelayMs = 1000;
+
+	/**
+	* @brief Silence after which a subscriber is pinged, in milliseconds.
+	*
+	* Connections that carry traffic are not pinged. 0 disables heartbeats.
+	* Default is 30000.
+	*/
+	int heartbeatIntervalMs = 30000;
+
+	/**
+	* @brief Silence after which a subscriber is closed, in milliseconds.
+	*
+	* Any received frame, including the answer to a ping, counts as
+	* activity. 0 keeps idle connections open. Default is 90000.
+	*/
+	int idleTimeoutMs = 90000;
+};
+
+
+/**
+* @brief Change of a single object in a collection.
+*
+* Sent to the subscribers as UTF-8 JSON in a binary WebSocket message:
+* `{"type":"change","collectionId":"Roles","objectId":"...","operation":"Updated"}`
+*
+* With NotificationConfig::coalescingWindowMs set, a batch with several
+* objects is sent as
+* `{"type":"changes","collectionId":"Roles","changes":[{"objectId":"...","operation":"Updated"},...]}`
+*
+* @see CAuthorizableServer::PublishChange()
+*/
+struct ChangeNotification
+{
+	/** @brief Collection of the changed object, e.g. "Users", "Roles", "UserGroups". */
+	QByteArray collectionId;
+
+	/** @brief ID of the changed object. */
+	QByteArray objectId;
+
+	/** @brief Kind of change, e.g. "Inserted", "Updated" or "Removed". */
+	QByteArray operation;
+
+	/** @brief Tenant the object belongs to. Empty for objects shared by all tenants. */
+	QByteArray tenantId;
+
+	/** @brief Permission a subscriber needs to see the change. Empty if none is needed. */
+	QByteArray requiredPermission;
+};
+
+
+/**
+* @brief What a notification subscriber may see and wants to receive.
+*
+* A notification is delivered to a subscriber only if
+* - the notification has no tenant, the tenants match, or the subscriber
+*   has allTenants set,
+* - the collection is listed in collectionIds, or the list is empty,
+* - the subscriber holds the required permission of the notification.
+*
+* @see CAuthorizableServer::AttachSubscriber(), ChangeNotification
+*/
+struct SubscriberContext
+{
+	/**
+	* @brief Tenant selected by the connection (SelectTenant).
+	*
+	* A connection without tenant only receives notifications of objects
+	* shared by all tenants.
+	*/
+	QByteArray tenantId;
+
+	/**
+	* @brief Receives the notifications of every tenant, regardless of tenantId.
+	*
+	* Only for connections whose user may see all tenants, e.g. system
+	* administrators. Never derived from an empty tenantId.
+	*/
+	bool allTenants = false;
+
+	/** @brief Collections the connection subscribed to. Empty subscribes to all. */
+	QByteArrayList collectionIds;
+
+	/** @brief Permissions of the connection's user. */
+	QByteArrayList permissions;
+
+	/**
+	* @brief Expiration of the connection's session.
+	*
+	* When reached, the subscriber receives `{"type":"sessionExpired"}` and
+	* the connection is closed. Invalid (default) for sessions without expiry.
+	*/
+	QDateTime sessionExpiration;
+};
+
+
+/**
+* @brief Runtime statistics of the server.
+*
+* Snapshot returned by CAuthorizableServer::GetStatistics(). Queue wait
+* time and execution time of the database executor are reported
+* separately: a growing queue wait with a stable execution time indicates
+* that the executor is too small for the load, while a growing execution
+* time points to slow queries or a slow database.
+*
+* @see CAuthorizableServer::GetStatistics(), DatabaseExecutorConfig
+*/
+struct ServerStatistics
+{
+	/** @brief Requests between BeginRequest() and EndRequest(). */
+	int activeRequests = 0;
+
+	/** @brief Number of requests admitted by AdmitRequest(). */
+	qint64 admittedRequests = 0;
+
+	/** @brief Number of requests rejected by the rate limiter. */
+	qint64 rateLimitedRequests = 0;
+
+	/** @brief Number of WebSocket connections attached as notification subscribers. */
+	int subscribers = 0;
+
+	/** @brief Number of notifications passed to PublishChange(). */
+	qint64 publishedChanges = 0;
+
+	/** @brief Number of messages written to subscribers. */
+	qint64 deliveredNotifications = 0;
+
+	/**
+	* @brief Fan-out latency percentiles, in milliseconds.
+	*
+	* Time from PublishChange() until a sender thread has written the
+	* notification to all of its subscribers, over the last 1024 batches.
+	*/
+	double fanOutLatencyP50Ms = 0.0;
+	double fanOutLatencyP95Ms = 0.0;
+	double fanOutLatencyP99Ms = 0.0;
+
+	/** @brief Largest number of notifications queued for one subscriber since the server was created. */
+	int subscriberQueueHighWaterMark = 0;
+
+	/** @brief Number of notifications discarded because a subscriber queue was full. */
+	qint64 droppedNotifications = 0;
+
+	/** @brief Number of resync messages sent to slow subscribers. */
+	qint64 resyncRequests = 0;
+
+	/** @brief Number of slow subscribers disconnected by SlowConsumerPolicy::Disconnect. */
+	qint64 disconnectedSlowSubscribers = 0;
+
+	/** @brief Number of changes merged into a pending batch instead of being sent on their own. */
+	qint64 coalescedChanges = 0;
+
+	/** @brief Number of pings sent to silent subscribers. */
+	qint64 heartbeatsSent = 0;
+
+	/** @brief Number of subscribers closed after NotificationConfig::idleTimeoutMs. */
+	qint64 idleSubscribersClosed = 0;
+
+	/** @brief Number of subscribers closed because SubscriberContext::sessionExpiration was reached. */
+	qint64 expiredSubscriberSessions = 0;
+
+	/**
+	* @brief Longest processing time of a heartbeat timer tick, in milliseconds.
+	*
+	* Each sender thread advances its timer wheel every 100 ms; the time
+	* grows with the number of due subscribers, not with the number of
+	* connections.
+	*/
+	double maxTimerTickMs = 0.0;
+
+	/** @brief Configured number of database threads. */
+	int databaseThreads = 0;
+
+	/** @brief Number of database tasks currently running. */
+	int activeDatabaseTasks = 0;
+
+	/** @brief Number of database tasks waiting for a free thread. */
+	int databaseQueueDepth = 0;
+
+	/** @brief Number of database tasks that have run. */
+	qint64 completedDatabaseTasks = 0;
+
+	/** @brief Number of database tasks rejected because the queue was full. */
+	qint64 rejectedDatabaseTasks = 0;
+
+	/** @brief Number of database tasks skipped because their deadline passed in the queue. */
+	qint64 expiredDatabaseTasks = 0;
+
+	/** @brief Number of queued database tasks canceled by Stop(). */
+	qint64 canceledDatabaseTasks = 0;
+
+	/** @brief Average time a database task waited in the queue, in milliseconds. */
+	double averageDatabaseQueueWaitMs = 0.0;
+
+	/** @brief Longest time a database task waited in the queue, in milliseconds. */
+	double maxDatabaseQueueWaitMs = 0.0;
+
+	/** @brief Average execution time of a database task, in milliseconds. */
+	double averageDatabaseTaskMs = 0.0;
+
+	/** @brief Longest execution time of a database task, in milliseconds. */
+	double maxDatabaseTaskMs = 0.0;
 };
 
 
@@ -364,6 +782,51 @@ struct ServerConfig
 	* @see SslConfig
 	*/
 	std::optional<SslConfig> sslConfig;
+
+	/**
+	* @brief Database executor configuration.
+	*
+	* Sized independently of the network threads.
+	*
+	* @see DatabaseExecutorConfig
+	*/
+	DatabaseExecutorConfig databaseExecutor;
+
+	/**
+	* @brief Port of the Prometheus metrics endpoint.
+	*
+	* When set, `GET /metrics` on this port returns the server statistics
+	* in the Prometheus text format. The endpoint is always plain HTTP.
+	* Default is 0 (disabled).
+	*
+	* @see metricsHost
+	*/
+	int metricsPort = 0;
+
+	/**
+	* @brief Interface the metrics endpoint is bound to.
+	*
+	* Independent of `host`, so the API can be public while the metrics stay
+	* internal. Default is "localhost", which only accepts local scrapers.
+	*
+	* @note The endpoint has no authentication. Only set an address that
+	*       is reachable from the monitoring network, never a public one.
+	*/
+	QString metricsHost = "localhost";
+
+	/**
+	* @brief Per-client rate limiting, disabled by default.
+	*
+	* @see RateLimitConfig, CAuthorizableServer::AdmitRequest()
+	*/
+	RateLimitConfig rateLimit;
+
+	/**
+	* @brief Change notification fan-out settings.
+	*
+	* @see NotificationConfig
+	*/
+	NotificationConfig notifications;
 };
 
 
@@ -489,6 +952,8 @@ public:
 	*         - Missing or invalid certificate files
 	*         - Insufficient permissions (e.g., binding to ports < 1024)
 	*         - Required interface not available
+	*         A failed call stops the listeners, timers and endpoints it
+	*         already started, as Stop() does.
 	*
 	* @note This method blocks briefly during initialization but returns
 	*       once the server is running. The server then handles requests
@@ -542,6 +1007,40 @@ public:
 	*/
 	virtual bool Stop() const;
 
+	/**
+	* @brief Stops the server after draining in-flight work.
+	*
+	* Intended for rolling deployments. The shutdown process:
+	* 1. BeginRequest() starts refusing new requests
+	* 2. Runs a local event loop until the requests between BeginRequest()
+	*    and EndRequest() and the database tasks are finished, then closes
+	*    the HTTP listener
+	* 3. Releases the coalesced change notifications and waits until the
+	*    subscribers have received their send queues
+	* 4. Sends a close frame to every notification subscriber at a random
+	*    time within the remaining window, so that the clients of several
+	*    nodes stopped together do not reconnect at the same moment
+	* 5. Closes the WebSocket listener and the remaining connections
+	*
+	* @param drainTimeoutMs Upper bound for the whole shutdown in
+	*                       milliseconds. A value of 0 or less behaves
+	*                       like Stop().
+	*
+	* @return true if the server was stopped.
+	* @return false if stopping a listener failed.
+	*
+	* @note Requests are only waited for if their handlers report them
+	*       through BeginRequest() and EndRequest(); the handlers of the
+	*       ImtCore HTTP framework do not. WebSocket connections
+	*       that are not attached as subscribers are closed together by
+	*       the listener in the last step.
+	* @note Database tasks still queued when the timeout expires are
+	*       canceled, tasks already running are waited for.
+	*
+	* @see Stop(), BeginRequest()
+	*/
+	virtual bool Stop(int drainTimeoutMs) const;
+
 	/**
 	* @brief Sets the path to the features configuration file.
 	*
@@ -616,6 +1115,173 @@ public:
 	*/
 	virtual bool SetProductId(const QByteArray& productId) const;
 
+	/**
+	* @brief Replaces the TLS certificate and key of the running server.
+	*
+	* All files are parsed and checked before anything is applied, so that
+	* an incomplete or invalid file set leaves the current material in
+	* place. The listeners are not restarted: established connections keep
+	* their session, new handshakes use the reloaded certificate and key.
+	*
+	* @param sslConfig New SSL configuration. The protocol and peer verify
+	*                  mode are applied as well.
+	*
+	* @return true if the new material was validated and applied.
+	* @return false if a file is missing or cannot be parsed, or the SSL
+	*         configuration interface is unavailable.
+	*
+	* @note Must be called from the thread that called Start().
+	*
+	* @see SslConfig::reloadOnFileChange
+	*/
+	virtual bool ReloadSsl(const SslConfig& sslConfig) const;
+
+	/**
+	* @brief Registers a request that a draining Stop() waits for.
+	*
+	* Called by a request handler before it processes the request. Every
+	* successful call must be paired with EndRequest() once the response
+	* is written.
+	*
+	* @return true if the request may be processed.
+	* @return false while the server is stopping; the caller should answer
+	*         with HTTP 503 (Service Unavailable) and not call EndRequest().
+	*
+	* @note Thread-safe, may be called from any request thread.
+	*
+	* @see EndRequest(), Stop(int)
+	*/
+	virtual bool BeginRequest() const;
+
+	/**
+	* @brief Marks a request registered by BeginRequest() as finished.
+	*
+	* @note Thread-safe, may be called from any request thread.
+	*/
+	virtual void EndRequest() const;
+
+	/**
+	* @brief Decides whether a request of a client is admitted.
+	*
+	* Takes one token of the given cost class from the bucket of every key.
+	* The request is admitted only if all keys have a token left, in that
+	* case the caller processes it; otherwise the caller should answer
+	* immediately with HTTP 429 (Too Many Requests) instead of queueing the
+	* request.
+	*
+	* @param clientKeys Identities of the caller, e.g. "user:<id>",
+	*                   "tenant:<id>", "pat:<id>" and "ip:<address>".
+	*                   The prefixes keep keys of different kinds apart.
+	* @param cost Cost class of the request.
+	*
+	* @return true if the request is admitted (always when rate limiting
+	*         is disabled).
+	* @return false if one of the keys has exhausted its budget.
+	*
+	* @note Thread-safe, may be called from any request thread.
+	*
+	* @see RateLimitConfig, ServerStatistics
+	*/
+	virtual bool AdmitRequest(const QList<QByteArray>& clientKeys, RequestCost cost = RequestCost::Cheap) const;
+
+	/**
+	* @brief Attaches a WebSocket connection that receives change notifications.
+	*
+	* The server takes ownership of the socket and moves it to one of the
+	* notification sender threads; the caller must not use it afterwards.
+	* The subscriber is removed automatically when the socket disconnects.
+	*
+	* @param socketPtr Connected socket. Must be called from the thread the
+	*                  socket lives in.
+	* @param context Tenant, collections and permissions used to select
+	*                the notifications the subscriber receives.
+	*
+	* @return Subscriber ID for DetachSubscriber(), or -1 if the socket is
+	*         not connected or the server implementation is unavailable.
+	*
+	* @see PublishChange(), NotificationConfig, SubscriberContext
+	*/
+	virtual qint64 AttachSubscriber(QWebSocket* socketPtr, const SubscriberContext& context = SubscriberContext()) const;
+
+	/**
+	* @brief Replaces the context of a subscriber.
+	*
+	* Call it when the connection selects another tenant or the
+	* permissions of its user change.
+	*
+	* @return false if the subscriber is unknown.
+	*
+	* @note Thread-safe.
+	*/
+	virtual bool UpdateSubscriberContext(qint64 subscriberId, const SubscriberContext& context) const;
+
+	/**
+	* @brief Closes the connection of a subscriber and removes it.
+	*/
+	virtual void DetachSubscriber(qint64 subscriberId) const;
+
+	/**
+	* @brief Sends a change notification to the matching subscribers.
+	*
+	* Subscribers are indexed by tenant and collection, so selecting the
+	* recipients costs time proportional to the number of matching
+	* subscribers, not to the number of connections. The notification is
+	* serialized and UTF-8 encoded once; the sender threads write the shared
+	* buffer to their recipients in one batch each, so the calling thread is not blocked by
+	* the number of connections.
+	*
+	* With NotificationConfig::coalescingWindowMs set, bursts of changes to a
+	* collection, e.g. from a bulk import, are merged into one message.
+	*
+	* @note Thread-safe, may be called from any thread, typically from the
+	*       collection change notifiers.
+	*
+	* @see ChangeNotification, ServerStatistics
+	*/
+	virtual void PublishChange(const ChangeNotification& notification) const;
+
+	/**
+	* @brief Runs database work on the database executor.
+	*
+	* The calling thread, typically a GraphQL handler, continues
+	* immediately and resumes in @p callback once the task is done. The
+	* callback is invoked in the thread that created the server, which needs
+	* a running event loop. @p contextPtr has to live in that thread; the
+	* callback is dropped if the context object is destroyed first. Without
+	* a context object, the callback runs in the database thread.
+	*
+	* A task still queued when its deadline passes is not run, the callback
+	* receives DatabaseTaskStatus::DeadlineExceeded. A running task is not
+	* interrupted; it receives the deadline to bound its own query.
+	*
+	* @param task Database work, runs in a database thread.
+	* @param contextPtr Object in the thread of the server that the callback belongs to, may be nullptr.
+	* @param callback Continuation, may be empty.
+	* @param deadlineMs Time budget from now in milliseconds, 0 selects DatabaseExecutorConfig::defaultDeadlineMs.
+	* @return false if the task was rejected because the queue is full,
+	*         @p contextPtr lives in another thread or the server
+	*         implementation is unavailable; the callback is not invoked then.
+	*
+	* @note Thread-safe.
+	*
+	* @see DatabaseExecutorConfig, ServerStatistics
+	*/
+	virtual bool ExecuteDatabaseTask(const DatabaseTask& task, QObject* contextPtr, const DatabaseTaskCallback& callback, int deadlineMs = 0) const;
+
+	/**
+	* @brief Returns runtime statistics of the server.
+	*
+	* The snapshot contains the counters of the SDK helpers, among them the
+	* database executor with queue wait and execution times measured
+	* separately. It can be polled periodically to size a node.
+	*
+	* @return Current statistics. All counters are zero if the server
+	*         implementation is not available.
+	*
+	* @see ServerStatistics, DatabaseExecutorConfig
+	*/
+	virtual ServerStatistics GetStatistics() const;
+
 private:
 	/**
 	* @brief Pointer to the internal implementation.
@@ -758,6 +1424,7 @@ private:
 * @section api_reference API Reference
 *
 * - CAuthorizableServer - Main server control class
+* - CJsonStreamWriter - Chunked streaming of large JSON list responses (CJsonStreamWriter.h)
 * - ServerConfig - Network configuration
 * - SslConfig - SSL/TLS security settings
 *
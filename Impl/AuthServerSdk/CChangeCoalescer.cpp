@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#include <AuthServerSdk/CChangeCoalescer.h>
+
+
+// Qt includes
+#include <QtCore/QTimer>
+
+
+namespace AuthServerSdk
+{
+
+
+// public methods
+
+CChangeCoalescer::CChangeCoalescer(const PublishCallback& callback)
+	:m_callback(callback),
+	m_contextPtr(new QObject),
+	m_timerPtr(nullptr),
+	m_windowMs(0),
+	m_maxDelayMs(0),
+	m_coalescedCount(0)
+{
+	m_clock.start();
+
+	m_thread.setObjectName("NotificationCoalescer");
+
+	m_timerPtr = new QTimer(m_contextPtr);
+	m_timerPtr->setSingleShot(true);
+	QObject::connect(m_timerPtr, &QTimer::timeout, m_contextPtr, [this](){
+		ProcessPending();
+	});
+
+	m_contextPtr->moveToThread(&m_thread);
+}
+
+
+CChangeCoalescer::~CChangeCoalescer()
+{
+	Stop();
+}
+
+
+void CChangeCoalescer::Configure(int windowMs, int maxDelayMs)
+{
+	{
+		QMutexLocker lock(&m_mutex);
+
+		m_windowMs = qMax(0, windowMs);
+		m_maxDelayMs = qMax(m_windowMs, maxDelayMs);
+	}
+
+	if (windowMs <= 0){
+		Flush();
+
+		return;
+	}
+
+	if (m_contextPtr != nullptr && !m_thread.isRunning()){
+		m_thread.start();
+	}
+}
+
+
+bool CChangeCoalescer::Add(const ChangeNotification& notification)
+{
+	bool isNewBatch = false;
+	{
+		QMutexLocker lock(&m_mutex);
+
+		if (m_windowMs <= 0){
+			return false;
+		}
+
+		const QByteArray key = notification.tenantId + '\n' + notification.collectionId + '\n' + notification.requiredPermission;
+		const qint64 nowMs = m_clock.elapsed();
+
+		QHash<QByteArray, Batch>::iterator batchIter = m_pending.find(key);
+		if (batchIter == m_pending.end()){
+			batchIter = m_pending.insert(key, Batch());
+			batchIter->collectionId = notification.collectionId;
+			batchIter->tenantId = notification.tenantId;
+			batchIter->requiredPermission = notification.requiredPermission;
+			batchIter->firstChangeMs = nowMs;
+
+			isNewBatch = true;
+		}
+		else{
+			m_coalescedCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		batchIter->lastChangeMs = nowMs;
+
+		QHash<QByteArray, int>& positions = m_objectPositions[key];
+		QHash<QByteArray, int>::const_iterator positionIter = positions.constFind(notification.objectId);
+		if (positionIter != positions.constEnd()){
+			// Only the latest operation of an object is relevant to the clients
+			batchIter->operations[*positionIter] = notification.operation;
+		}
+		else{
+			positions.insert(notification.objectId, batchIter->objectIds.size());
+			batchIter->objectIds.append(notification.objectId);
+			batchIter->operations.append(notification.operation);
+		}
+	}
+
+	// Extended deadlines are picked up when the timer fires, only a new batch can be due earlier
+	if (isNewBatch){
+		QMetaObject::invokeMethod(m_contextPtr, [this](){
+			ProcessPending();
+		}, Qt::QueuedConnection);
+	}
+
+	return true;
+}
+
+
+void CChangeCoalescer::Flush()
+{
+	QHash<QByteArray, Batch> pending;
+	{
+		QMutexLocker lock(&m_mutex);
+
+		pending.swap(m_pending);
+		m_objectPositions.clear();
+	}
+
+	for (const Batch& batch : pending){
+		m_callback(batch);
+	}
+}
+
+
+void CChangeCoalescer::Stop()
+{
+	if (m_contextPtr == nullptr){
+		return;
+	}
+
+	{
+		// Later changes are published directly
+		QMutexLocker lock(&m_mutex);
+
+		m_windowMs = 0;
+	}
+
+	m_thread.quit();
+	m_thread.wait();
+
+	// The thread has finished, deleting its objects from here is safe
+	delete m_contextPtr;
+	m_contextPtr = nullptr;
+	m_timerPtr = nullptr;
+}
+
+
+qint64 CChangeCoalescer::GetCoalescedCount() const
+{
+	return m_coalescedCount.load(std::memory_order_relaxed);
+}
+
+
+// private methods
+
+void CChangeCoalescer::ProcessPending()
+{
+	QList<Batch> dueBatches;
+	qint64 nextDeadlineMs = -1;
+	{
+		QMutexLocker lock(&m_mutex);
+
+		const qint64 nowMs = m_clock.elapsed();
+
+		QHash<QByteArray, Batch>::iterator batchIter = m_pending.begin();
+		while (batchIter != m_pending.end()){
+			const qint64 deadlineMs = GetDeadline(*batchIter);
+			if (deadlineMs <= nowMs){
+				dueBatches.append(*batchIter);
+				m_objectPositions.remove(batchIter.key());
+				batchIter = m_pending.erase(batchIter);
+			}
+			else{
+				nextDeadlineMs = (nextDeadlineMs < 0) ? deadlineMs : qMin(nextDeadlineMs, deadlineMs);
+				++batchIter;
+			}
+		}
+	}
+
+	for (const Batch& batch : dueBatches){
+		m_callback(batch);
+	}
+
+	if (nextDeadlineMs >= 0){
+		m_timerPtr->start(int(qMax(qint64(0), nextDeadlineMs - m_clock.elapsed())));
+	}
+}
+
+
+qint64 CChangeCoalescer::GetDeadline(const Batch& batch) const
+{
+	return qMin(batch.lastChangeMs + m_windowMs, batch.firstChangeMs + m_maxDelayMs);
+}
+
+
+} // namespace AuthServerSdk
+
+
@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#pragma once
+
+
+// STL includes
+#include <atomic>
+#include <functional>
+
+// Qt includes
+#include <QtCore/QByteArrayList>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+// AuthServerSdk includes
+#include <AuthServerSdk/AuthServerSdk.h>
+
+
+class QTimer;
+
+
+namespace AuthServerSdk
+{
+
+
+/**
+* @brief Merges bursts of change notifications into one batch per collection.
+*
+* Notifications with the same collection, tenant and required permission
+* are collected in a pending batch. Repeated changes of an object keep its
+* position in the batch and only replace the operation. The batch is
+* released once no further change has arrived for the coalescing window,
+* but never later than the maximum delay after its first change, so a
+* continuous stream of edits cannot hold it back indefinitely.
+*
+* A single timer in an own thread is armed for the earliest deadline of all
+* pending batches; adding a change only wakes that thread when it opens a
+* new batch.
+*
+* @note The coalescer is internal to the SDK and is not exported.
+*/
+class CChangeCoalescer
+{
+public:
+	/**
+	* @brief Changes of one collection released together.
+	*/
+	struct Batch
+	{
+		QByteArray collectionId;
+		QByteArray tenantId;
+		QByteArray requiredPermission;
+
+		/** @brief Changed objects in the order of their first change. */
+		QByteArrayList objectIds;
+
+		/** @brief Latest operation of each object, parallel to objectIds. */
+		QByteArrayList operations;
+
+		qint64 firstChangeMs = 0;
+		qint64 lastChangeMs = 0;
+	};
+
+	typedef std::function<void(const Batch&)> PublishCallback;
+
+	explicit CChangeCoalescer(const PublishCallback& callback);
+	~CChangeCoalescer();
+
+	/**
+	* @brief Sets the coalescing window and the maximum delay.
+	*
+	* A window of 0 disables coalescing and releases the pending batches.
+	*/
+	void Configure(int windowMs, int maxDelayMs);
+
+	/**
+	* @brief Adds a change to the pending batch of its collection. Thread-safe.
+	* @return false if coalescing is disabled and the change has to be published directly.
+	*/
+	bool Add(const ChangeNotification& notification);
+
+	/**
+	* @brief Releases all pending batches from the calling thread.
+	*/
+	void Flush();
+
+	/**
+	* @brief Stops the timer thread for good. Pending batches stay until Flush().
+	*/
+	void Stop();
+
+	/**
+	* @brief Number of changes merged into an already pending batch.
+	*/
+	qint64 GetCoalescedCount() const;
+
+private:
+	void ProcessPending();
+	qint64 GetDeadline(const Batch& batch) const;
+
+private:
+	PublishCallback m_callback;
+	QElapsedTimer m_clock;
+
+	QThread m_thread;
+	QObject* m_contextPtr;
+	QTimer* m_timerPtr;
+
+	mutable QMutex m_mutex;
+	QHash<QByteArray, Batch> m_pending;
+	QHash<QByteArray, QHash<QByteArray, int>> m_objectPositions;
+	int m_windowMs;
+	int m_maxDelayMs;
+
+	std::atomic<qint64> m_coalescedCount;
+};
+
+
+} // namespace AuthServerSdk
+
+
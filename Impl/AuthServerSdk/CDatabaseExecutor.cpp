@@ -0,0 +1,226 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#include <AuthServerSdk/CDatabaseExecutor.h>
+
+
+// Qt includes
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+
+
+namespace AuthServerSdk
+{
+
+
+static void UpdateMaximum(std::atomic<qint64>& maximum, qint64 value)
+{
+	qint64 current = maximum.load(std::memory_order_relaxed);
+	while (value > current && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed)){
+	}
+}
+
+
+class CDatabaseExecutor::CTaskRunnable: public QRunnable
+{
+public:
+	CTaskRunnable(CDatabaseExecutor& parent, const DatabaseTask& task, QObject* contextPtr, const DatabaseTaskCallback& callback, int deadlineMs)
+		:m_parent(parent),
+		m_task(task),
+		m_contextPtr(contextPtr),
+		m_hasContext(contextPtr != nullptr),
+		m_callback(callback),
+		m_deadline((deadlineMs > 0) ? QDeadlineTimer(deadlineMs) : QDeadlineTimer(QDeadlineTimer::Forever)),
+		m_isStarted(false)
+	{
+		m_queueTimer.start();
+	}
+
+	~CTaskRunnable() override
+	{
+		// Task was removed from the queue by ClearQueue() without being started
+		if (!m_isStarted){
+			m_parent.m_queuedCount--;
+			m_parent.m_canceledCount.fetch_add(1, std::memory_order_relaxed);
+
+			m_parent.Complete(m_contextPtr, m_hasContext, m_callback, DatabaseTaskStatus::Canceled);
+		}
+	}
+
+	// reimplemented (QRunnable)
+	void run() override
+	{
+		m_isStarted = true;
+		m_parent.m_queuedCount--;
+
+		const qint64 queueWaitUs = m_queueTimer.nsecsElapsed() / 1000;
+		m_parent.m_startedCount.fetch_add(1, std::memory_order_relaxed);
+		m_parent.m_totalQueueWaitUs.fetch_add(queueWaitUs, std::memory_order_relaxed);
+		UpdateMaximum(m_parent.m_maxQueueWaitUs, queueWaitUs);
+
+		// The caller has given up on the result, the query is not worth running
+		if (m_deadline.hasExpired()){
+			m_parent.m_expiredCount.fetch_add(1, std::memory_order_relaxed);
+			m_parent.Complete(m_contextPtr, m_hasContext, m_callback, DatabaseTaskStatus::DeadlineExceeded);
+
+			return;
+		}
+
+		QElapsedTimer taskTimer;
+		taskTimer.start();
+
+		if (m_task){
+			m_task(m_deadline);
+		}
+
+		const qint64 taskUs = taskTimer.nsecsElapsed() / 1000;
+		m_parent.m_completedCount.fetch_add(1, std::memory_order_relaxed);
+		m_parent.m_totalTaskUs.fetch_add(taskUs, std::memory_order_relaxed);
+		UpdateMaximum(m_parent.m_maxTaskUs, taskUs);
+
+		m_parent.Complete(m_contextPtr, m_hasContext, m_callback, DatabaseTaskStatus::Completed);
+	}
+
+private:
+	CDatabaseExecutor& m_parent;
+	DatabaseTask m_task;
+	QPointer<QObject> m_contextPtr;
+	bool m_hasContext;
+	DatabaseTaskCallback m_callback;
+	QDeadlineTimer m_deadline;
+	QElapsedTimer m_queueTimer;
+	bool m_isStarted;
+};
+
+
+// public methods
+
+CDatabaseExecutor::CDatabaseExecutor()
+	:m_maxQueueDepth(0),
+	m_defaultDeadlineMs(0),
+	m_queuedCount(0),
+	m_rejectedCount(0),
+	m_expiredCount(0),
+	m_canceledCount(0),
+	m_startedCount(0),
+	m_completedCount(0),
+	m_totalQueueWaitUs(0),
+	m_maxQueueWaitUs(0),
+	m_totalTaskUs(0),
+	m_maxTaskUs(0)
+{
+	// Threads stay alive so that their database connections are reused
+	m_threadPool.setExpiryTimeout(-1);
+	m_threadPool.setMaxThreadCount(GetDefaultThreads());
+}
+
+
+CDatabaseExecutor::~CDatabaseExecutor()
+{
+	ClearQueue();
+	m_threadPool.waitForDone();
+}
+
+
+void CDatabaseExecutor::Configure(const DatabaseExecutorConfig& config)
+{
+	m_threadPool.setMaxThreadCount(config.threads > 0 ? config.threads : GetDefaultThreads());
+	m_maxQueueDepth.store(qMax(0, config.maxQueueDepth), std::memory_order_relaxed);
+	m_defaultDeadlineMs.store(qMax(0, config.defaultDeadlineMs), std::memory_order_relaxed);
+}
+
+
+bool CDatabaseExecutor::Submit(const DatabaseTask& task, QObject* contextPtr, const DatabaseTaskCallback& callback, int deadlineMs)
+{
+	// The context is only safe to check in its own thread, which has to be the thread of the receiver
+	if (contextPtr != nullptr && contextPtr->thread() != m_receiver.thread()){
+		qWarning() << "Database task context must live in the thread that owns the server";
+
+		return false;
+	}
+
+	const int maxQueueDepth = m_maxQueueDepth.load(std::memory_order_relaxed);
+
+	int queuedCount = ++m_queuedCount;
+	if ((maxQueueDepth > 0) && (queuedCount > maxQueueDepth)){
+		m_queuedCount--;
+		m_rejectedCount.fetch_add(1, std::memory_order_relaxed);
+
+		return false;
+	}
+
+	CTaskRunnable* runnablePtr = new CTaskRunnable(*this, task, contextPtr, callback, (deadlineMs > 0) ? deadlineMs : m_defaultDeadlineMs.load(std::memory_order_relaxed));
+	runnablePtr->setAutoDelete(true);
+
+	m_threadPool.start(runnablePtr);
+
+	return true;
+}
+
+
+bool CDatabaseExecutor::WaitForDone(int msecs)
+{
+	return m_threadPool.waitForDone(msecs);
+}
+
+
+void CDatabaseExecutor::ClearQueue()
+{
+	m_threadPool.clear();
+}
+
+
+void CDatabaseExecutor::GetStatistics(ServerStatistics& statistics) const
+{
+	statistics.databaseThreads = m_threadPool.maxThreadCount();
+	statistics.activeDatabaseTasks = m_threadPool.activeThreadCount();
+	statistics.databaseQueueDepth = m_queuedCount;
+	statistics.rejectedDatabaseTasks = m_rejectedCount.load(std::memory_order_relaxed);
+	statistics.expiredDatabaseTasks = m_expiredCount.load(std::memory_order_relaxed);
+	statistics.canceledDatabaseTasks = m_canceledCount.load(std::memory_order_relaxed);
+
+	qint64 completedCount = m_completedCount.load(std::memory_order_relaxed);
+	qint64 startedCount = m_startedCount.load(std::memory_order_relaxed);
+
+	statistics.completedDatabaseTasks = completedCount;
+	statistics.averageDatabaseQueueWaitMs = (startedCount > 0) ? m_totalQueueWaitUs.load(std::memory_order_relaxed) / 1000.0 / startedCount : 0.0;
+	statistics.maxDatabaseQueueWaitMs = m_maxQueueWaitUs.load(std::memory_order_relaxed) / 1000.0;
+	statistics.averageDatabaseTaskMs = (completedCount > 0) ? m_totalTaskUs.load(std::memory_order_relaxed) / 1000.0 / completedCount : 0.0;
+	statistics.maxDatabaseTaskMs = m_maxTaskUs.load(std::memory_order_relaxed) / 1000.0;
+}
+
+
+int CDatabaseExecutor::GetDefaultThreads()
+{
+	// Every thread holds a database connection, the server side limits how many are useful
+	return qBound(2, QThread::idealThreadCount(), 16);
+}
+
+
+// private methods
+
+void CDatabaseExecutor::Complete(const QPointer<QObject>& contextPtr, bool hasContext, const DatabaseTaskCallback& callback, DatabaseTaskStatus status)
+{
+	if (!callback){
+		return;
+	}
+
+	if (!hasContext){
+		callback(status);
+
+		return;
+	}
+
+	// The context may be destroyed at any time until the check runs in its own thread
+	QMetaObject::invokeMethod(&m_receiver, [contextPtr, callback, status](){
+		// The context is gone, nobody waits for the result any more
+		if (!contextPtr.isNull()){
+			callback(status);
+		}
+	}, Qt::QueuedConnection);
+}
+
+
+} // namespace AuthServerSdk
+
+
@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#pragma once
+
+
+// STL includes
+#include <atomic>
+
+// Qt includes
+#include <QtCore/QPointer>
+#include <QtCore/QThreadPool>
+
+// AuthServerSdk includes
+#include <AuthServerSdk/AuthServerSdk.h>
+
+
+namespace AuthServerSdk
+{
+
+
+/**
+* @brief Thread pool that runs the database work of the server.
+*
+* Database calls block their thread for the duration of the query. Running
+* them on a pool of their own keeps slow queries away from the network
+* threads, so the number of concurrent requests and the number of
+* concurrent queries can be sized separately.
+*
+* Threads are kept alive for the lifetime of the pool, so per-thread
+* database connections are reused. A task carries a deadline: when it is
+* still queued once the deadline has passed it is not run, and the task
+* itself receives the deadline to bound its query.
+*
+* Completions are posted to a receiver object of the executor that lives
+* in the thread that created it. The context object of a task has to live
+* in that thread as well; it is checked there, so a context destroyed
+* meanwhile is never touched and its callback is dropped.
+*
+* @note The executor is internal to the SDK and is not exported.
+*/
+class CDatabaseExecutor
+{
+public:
+	CDatabaseExecutor();
+	~CDatabaseExecutor();
+
+	void Configure(const DatabaseExecutorConfig& config);
+
+	/**
+	* @brief Queues a task.
+	* @param contextPtr Object in the thread of the executor that the callback
+	*                   belongs to, or nullptr to run the callback in the database thread.
+	* @param deadlineMs Time budget from now, 0 selects the configured default.
+	* @return false if the queue limit is reached or the context lives in another thread.
+	*/
+	bool Submit(const DatabaseTask& task, QObject* contextPtr, const DatabaseTaskCallback& callback, int deadlineMs);
+
+	/**
+	* @brief Waits until all queued and running tasks are finished.
+	* @param msecs Timeout in milliseconds, -1 waits without timeout.
+	*/
+	bool WaitForDone(int msecs = -1);
+
+	/**
+	* @brief Cancels all tasks that have not been started yet.
+	*/
+	void ClearQueue();
+
+	/**
+	* @brief Fills the database executor part of the server statistics.
+	*/
+	void GetStatistics(ServerStatistics& statistics) const;
+
+	/**
+	* @brief Default number of database threads derived from the CPU core count.
+	*/
+	static int GetDefaultThreads();
+
+private:
+	class CTaskRunnable;
+
+	void Complete(const QPointer<QObject>& contextPtr, bool hasContext, const DatabaseTaskCallback& callback, DatabaseTaskStatus status);
+
+private:
+	// Receives the completions in the thread that owns the executor, outlives all tasks
+	QObject m_receiver;
+
+	QThreadPool m_threadPool;
+	std::atomic<int> m_maxQueueDepth;
+	std::atomic<int> m_defaultDeadlineMs;
+
+	std::atomic<int> m_queuedCount;
+	std::atomic<qint64> m_rejectedCount;
+	std::atomic<qint64> m_expiredCount;
+	std::atomic<qint64> m_canceledCount;
+
+	std::atomic<qint64> m_startedCount;
+	std::atomic<qint64> m_completedCount;
+	std::atomic<qint64> m_totalQueueWaitUs;
+	std::atomic<qint64> m_maxQueueWaitUs;
+	std::atomic<qint64> m_totalTaskUs;
+	std::atomic<qint64> m_maxTaskUs;
+};
+
+
+} // namespace AuthServerSdk
+
+
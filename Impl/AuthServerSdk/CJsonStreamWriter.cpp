@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#include <AuthServerSdk/CJsonStreamWriter.h>
+
+
+// Qt includes
+#include <QtCore/QJsonDocument>
+#include <QtCore/QThread>
+#include <QtNetwork/QAbstractSocket>
+
+
+namespace AuthServerSdk
+{
+
+
+static const int s_socketWriteTimeoutMs = 30000;
+
+
+static QByteArray GetReasonPhrase(int statusCode)
+{
+	switch (statusCode){
+	case 200:
+		return "OK";
+	case 206:
+		return "Partial Content";
+	case 400:
+		return "Bad Request";
+	case 401:
+		return "Unauthorized";
+	case 403:
+		return "Forbidden";
+	case 404:
+		return "Not Found";
+	case 429:
+		return "Too Many Requests";
+	case 500:
+		return "Internal Server Error";
+	case 503:
+		return "Service Unavailable";
+	default:
+		return "Unknown";
+	}
+}
+
+
+// public methods
+
+CJsonStreamWriter::CJsonStreamWriter(QIODevice* devicePtr, int flushThreshold)
+	:m_devicePtr(devicePtr),
+	m_flushThreshold(qMax(1024, flushThreshold)),
+	m_elementCount(0),
+	m_bodySize(0),
+	m_isFailed(devicePtr == nullptr)
+{
+	m_buffer.reserve(m_flushThreshold);
+}
+
+
+bool CJsonStreamWriter::WriteHeader(int statusCode, const QByteArray& contentType, const QList<QByteArray>& extraHeaders)
+{
+	if (m_isFailed){
+		return false;
+	}
+
+	QByteArray header;
+	header.append("HTTP/1.1 ").append(QByteArray::number(statusCode)).append(' ').append(GetReasonPhrase(statusCode)).append("\r\n");
+	header.append("Content-Type: ").append(contentType).append("\r\n");
+	header.append("Transfer-Encoding: chunked\r\n");
+	for (const QByteArray& headerLine : extraHeaders){
+		header.append(headerLine).append("\r\n");
+	}
+	header.append("\r\n");
+
+	if (m_devicePtr->write(header) != header.size()){
+		m_isFailed = true;
+	}
+
+	return !m_isFailed;
+}
+
+
+bool CJsonStreamWriter::BeginArray(const QByteArray& prefix)
+{
+	return Append(prefix);
+}
+
+
+bool CJsonStreamWriter::WriteRawElement(const QByteArray& json)
+{
+	if (m_elementCount > 0 && !Append(",")){
+		return false;
+	}
+
+	m_elementCount++;
+
+	return Append(json);
+}
+
+
+bool CJsonStreamWriter::WriteElement(const QJsonObject& object)
+{
+	return WriteRawElement(QJsonDocument(object).toJson(QJsonDocument::Compact));
+}
+
+
+bool CJsonStreamWriter::EndArray(const QByteArray& suffix)
+{
+	if (!Append(suffix) || !Flush()){
+		return false;
+	}
+
+	// Zero-length chunk terminates the body
+	if (m_devicePtr->write("0\r\n\r\n") != 5){
+		m_isFailed = true;
+	}
+
+	return !m_isFailed;
+}
+
+
+qint64 CJsonStreamWriter::GetElementCount() const
+{
+	return m_elementCount;
+}
+
+
+qint64 CJsonStreamWriter::GetBodySize() const
+{
+	return m_bodySize;
+}
+
+
+// private methods
+
+bool CJsonStreamWriter::Append(const QByteArray& data)
+{
+	if (m_isFailed){
+		return false;
+	}
+
+	m_buffer.append(data);
+	m_bodySize += data.size();
+
+	if (m_buffer.size() >= m_flushThreshold){
+		return Flush();
+	}
+
+	return true;
+}
+
+
+bool CJsonStreamWriter::Flush()
+{
+	if (m_isFailed){
+		return false;
+	}
+
+	if (m_buffer.isEmpty()){
+		return true;
+	}
+
+	if (!WriteChunk(m_buffer)){
+		return false;
+	}
+
+	m_buffer.clear();
+
+	return true;
+}
+
+
+bool CJsonStreamWriter::WriteChunk(const QByteArray& data)
+{
+	QByteArray chunkHeader = QByteArray::number(data.size(), 16) + "\r\n";
+
+	if (m_devicePtr->write(chunkHeader) != chunkHeader.size()
+				|| m_devicePtr->write(data) != data.size()
+				|| m_devicePtr->write("\r\n") != 2){
+		m_isFailed = true;
+
+		return false;
+	}
+
+	// Let a slow client slow down the producer instead of growing the socket buffer
+	QAbstractSocket* socketPtr = qobject_cast<QAbstractSocket*>(m_devicePtr);
+	if (socketPtr != nullptr){
+		Q_ASSERT(socketPtr->thread() == QThread::currentThread());
+
+		while (socketPtr->bytesToWrite() > m_flushThreshold){
+			if (!socketPtr->waitForBytesWritten(s_socketWriteTimeoutMs)){
+				m_isFailed = true;
+
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+} // namespace AuthServerSdk
+
+
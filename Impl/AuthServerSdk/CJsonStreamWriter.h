@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#pragma once
+
+
+// Qt includes
+#include <QtCore/QByteArray>
+#include <QtCore/QIODevice>
+#include <QtCore/QJsonObject>
+#include <QtCore/QList>
+
+// AuthServerSdk includes
+#include <AuthServerSdk/AuthServerSdk.h>
+
+
+namespace AuthServerSdk
+{
+
+
+/**
+* @brief Streams a large JSON array as a chunked HTTP response.
+*
+* Writes the response header with `Transfer-Encoding: chunked` and then the
+* array elements as they are produced, e.g. row by row from a database
+* cursor. Elements are collected in a small buffer that is sent as one chunk
+* when it reaches the flush threshold, so the memory used for the response
+* stays constant regardless of the number of rows and the client receives
+* the first bytes before the last row has been read.
+*
+* @code
+* CJsonStreamWriter writer(socketPtr);
+* writer.WriteHeader(200);
+* writer.BeginArray("{\"data\":{\"UsersList\":{\"items\":[");
+* while (query.next()) {
+*     writer.WriteElement(UserToJson(query));
+* }
+* writer.EndArray("]}}}");
+* @endcode
+*
+* @note Like the socket itself, the writer must be used in the thread that
+*       owns the socket. When the device is a socket, the writer waits while
+*       more than the flush threshold is pending in the socket buffer, so a
+*       slow client slows down the producer instead of letting the buffer
+*       grow. Use it from a request handler thread, not from a thread whose
+*       event loop serves other connections.
+*/
+class AUTH_SERVER_SDK_EXPORT CJsonStreamWriter
+{
+public:
+	/**
+	* @param devicePtr Open device the response is written to, not owned.
+	* @param flushThreshold Chunk size in bytes. Default is 64 KiB.
+	*/
+	explicit CJsonStreamWriter(QIODevice* devicePtr, int flushThreshold = 64 * 1024);
+
+	/**
+	* @brief Writes the status line and headers of a chunked response.
+	*
+	* @param statusCode HTTP status code.
+	* @param contentType Value of the Content-Type header.
+	* @param extraHeaders Additional raw header lines without line breaks,
+	*                     e.g. "Cache-Control: no-store".
+	*/
+	bool WriteHeader(int statusCode, const QByteArray& contentType = "application/json", const QList<QByteArray>& extraHeaders = QList<QByteArray>());
+
+	/**
+	* @brief Starts the array after an optional JSON prefix that ends with '['.
+	*/
+	bool BeginArray(const QByteArray& prefix = "[");
+
+	/**
+	* @brief Appends an already serialized JSON value to the array.
+	*/
+	bool WriteRawElement(const QByteArray& json);
+
+	/**
+	* @brief Appends a JSON object to the array.
+	*/
+	bool WriteElement(const QJsonObject& object);
+
+	/**
+	* @brief Closes the array with an optional suffix and terminates the chunked body.
+	*/
+	bool EndArray(const QByteArray& suffix = "]");
+
+	/** @brief Number of array elements written so far. */
+	qint64 GetElementCount() const;
+
+	/** @brief Number of body bytes written so far, without chunk framing. */
+	qint64 GetBodySize() const;
+
+private:
+	bool Append(const QByteArray& data);
+	bool Flush();
+	bool WriteChunk(const QByteArray& data);
+
+private:
+	QIODevice* m_devicePtr;
+	int m_flushThreshold;
+	QByteArray m_buffer;
+	qint64 m_elementCount;
+	qint64 m_bodySize;
+	bool m_isFailed;
+};
+
+
+} // namespace AuthServerSdk
+
+
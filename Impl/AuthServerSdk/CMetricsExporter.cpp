@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#include <AuthServerSdk/CMetricsExporter.h>
+
+
+// Qt includes
+#include <QtCore/QDebug>
+#include <QtCore/QTimer>
+#include <QtNetwork/QHostAddress>
+#include <QtNetwork/QTcpSocket>
+
+
+namespace AuthServerSdk
+{
+
+
+static const int s_maxRequestHeaderSize = 8192;
+static const int s_requestTimeoutMs = 5000;
+
+
+// public methods
+
+CMetricsExporter::CMetricsExporter(const CollectFunction& collectFunction)
+	:m_collectFunction(collectFunction)
+{
+	QObject::connect(&m_server, &QTcpServer::newConnection, [this](){
+		OnNewConnection();
+	});
+}
+
+
+bool CMetricsExporter::Start(const QString& host, int port)
+{
+	Stop();
+
+	QHostAddress address;
+	if (host.isEmpty() || host == "0.0.0.0"){
+		address = QHostAddress::Any;
+	}
+	else if (host == "localhost"){
+		address = QHostAddress::LocalHost;
+	}
+	else if (!address.setAddress(host)){
+		qWarning() << "Invalid metrics host address" << host;
+		return false;
+	}
+
+	if (!m_server.listen(address, quint16(port))){
+		qWarning() << "Failed to start metrics endpoint on port" << port << ":" << m_server.errorString();
+		return false;
+	}
+
+	qDebug() << "Metrics endpoint started on port" << port;
+
+	return true;
+}
+
+
+void CMetricsExporter::Stop()
+{
+	if (m_server.isListening()){
+		m_server.close();
+	}
+}
+
+
+bool CMetricsExporter::IsListening() const
+{
+	return m_server.isListening();
+}
+
+
+// private methods
+
+void CMetricsExporter::OnNewConnection()
+{
+	while (m_server.hasPendingConnections()){
+		QTcpSocket* socketPtr = m_server.nextPendingConnection();
+
+		QObject::connect(socketPtr, &QTcpSocket::disconnected, socketPtr, &QObject::deleteLater);
+		QObject::connect(socketPtr, &QTcpSocket::readyRead, socketPtr, [this, socketPtr](){
+			OnReadyRead(socketPtr);
+		});
+
+		// Scrapers that never finish their request must not keep the socket open
+		QTimer::singleShot(s_requestTimeoutMs, socketPtr, [socketPtr](){
+			socketPtr->abort();
+		});
+	}
+}
+
+
+void CMetricsExporter::OnReadyRead(QTcpSocket* socketPtr)
+{
+	QByteArray request = socketPtr->peek(s_maxRequestHeaderSize + 1);
+	int headerEnd = request.indexOf("\r\n\r\n");
+	if (headerEnd < 0){
+		if (request.size() > s_maxRequestHeaderSize){
+			SendResponse(socketPtr, "431 Request Header Fields Too Large", "text/plain", QByteArray());
+		}
+
+		return;
+	}
+
+	socketPtr->read(headerEnd + 4);
+
+	QList<QByteArray> requestLine = request.left(request.indexOf("\r\n")).split(' ');
+	if (requestLine.size() < 2){
+		SendResponse(socketPtr, "400 Bad Request", "text/plain", QByteArray());
+
+		return;
+	}
+
+	if (requestLine[0] != "GET"){
+		SendResponse(socketPtr, "405 Method Not Allowed", "text/plain", QByteArray());
+
+		return;
+	}
+
+	QByteArray path = requestLine[1];
+	int queryStart = path.indexOf('?');
+	if (queryStart >= 0){
+		path.truncate(queryStart);
+	}
+
+	if (path != "/metrics"){
+		SendResponse(socketPtr, "404 Not Found", "text/plain", QByteArray());
+
+		return;
+	}
+
+	SendResponse(socketPtr, "200 OK", "text/plain; version=0.0.4; charset=utf-8", m_collectFunction ? m_collectFunction() : QByteArray());
+}
+
+
+void CMetricsExporter::SendResponse(QTcpSocket* socketPtr, const QByteArray& status, const QByteArray& contentType, const QByteArray& body)
+{
+	QByteArray response;
+	response.append("HTTP/1.1 ").append(status).append("\r\n");
+	response.append("Content-Type: ").append(contentType).append("\r\n");
+	response.append("Content-Length: ").append(QByteArray::number(body.size())).append("\r\n");
+	response.append("Connection: close\r\n\r\n");
+	response.append(body);
+
+	socketPtr->write(response);
+	socketPtr->disconnectFromHost();
+}
+
+
+} // namespace AuthServerSdk
+
+
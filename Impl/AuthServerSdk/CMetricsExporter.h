@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#pragma once
+
+
+// STL includes
+#include <functional>
+
+// Qt includes
+#include <QtCore/QByteArray>
+#include <QtNetwork/QTcpServer>
+
+
+class QTcpSocket;
+
+
+namespace AuthServerSdk
+{
+
+
+/**
+* @brief Minimal HTTP listener that serves metrics in the Prometheus text format.
+*
+* Answers `GET /metrics` with the text produced by the collect function and
+* closes the connection afterwards. The metrics text is only built when a
+* scrape arrives, so the exporter costs nothing between scrapes.
+*
+* @note The exporter lives in the thread that started it and needs a running
+*       Qt event loop there. It is internal to the SDK and is not exported.
+*/
+class CMetricsExporter
+{
+public:
+	typedef std::function<QByteArray()> CollectFunction;
+
+	explicit CMetricsExporter(const CollectFunction& collectFunction);
+
+	/**
+	* @brief Starts listening for scrape requests.
+	* @return false if the port could not be bound.
+	*/
+	bool Start(const QString& host, int port);
+
+	void Stop();
+
+	bool IsListening() const;
+
+private:
+	void OnNewConnection();
+	void OnReadyRead(QTcpSocket* socketPtr);
+	void SendResponse(QTcpSocket* socketPtr, const QByteArray& status, const QByteArray& contentType, const QByteArray& body);
+
+private:
+	CollectFunction m_collectFunction;
+	QTcpServer m_server;
+};
+
+
+} // namespace AuthServerSdk
+
+
@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#include <AuthServerSdk/CRateLimiter.h>
+
+
+// Qt includes
+#include <QtCore/QMutexLocker>
+#include <QtCore/QReadLocker>
+#include <QtCore/QWriteLocker>
+
+
+namespace AuthServerSdk
+{
+
+
+// public methods
+
+CRateLimiter::CRateLimiter()
+	:m_admittedCount(0),
+	m_rejectedCount(0)
+{
+	m_clock.start();
+}
+
+
+void CRateLimiter::Configure(const RateLimitConfig& config)
+{
+	QWriteLocker configLock(&m_configLock);
+
+	m_config = config;
+	m_config.cheapBurst = qMax(1, m_config.cheapBurst);
+	m_config.expensiveBurst = qMax(1, m_config.expensiveBurst);
+
+	for (Shard& shard : m_shards){
+		QMutexLocker lock(&shard.mutex);
+
+		shard.buckets.clear();
+	}
+}
+
+
+bool CRateLimiter::Admit(const QList<QByteArray>& clientKeys, RequestCost cost)
+{
+	// Held until the taken tokens are final, Configure() clears the buckets under the write lock
+	QReadLocker configLock(&m_configLock);
+
+	if (!m_config.enabled){
+		m_admittedCount.fetch_add(1, std::memory_order_relaxed);
+
+		return true;
+	}
+
+	qint64 nowNs = m_clock.nsecsElapsed();
+
+	for (int keyIndex = 0; keyIndex < clientKeys.size(); ++keyIndex){
+		if (!TakeToken(clientKeys[keyIndex], cost, nowNs)){
+			// Give back what the previous keys paid for the rejected request
+			for (int takenIndex = 0; takenIndex < keyIndex; ++takenIndex){
+				ReturnToken(clientKeys[takenIndex], cost);
+			}
+
+			m_rejectedCount.fetch_add(1, std::memory_order_relaxed);
+
+			return false;
+		}
+	}
+
+	m_admittedCount.fetch_add(1, std::memory_order_relaxed);
+
+	return true;
+}
+
+
+void CRateLimiter::GetStatistics(ServerStatistics& statistics) const
+{
+	statistics.admittedRequests = m_admittedCount.load(std::memory_order_relaxed);
+	statistics.rateLimitedRequests = m_rejectedCount.load(std::memory_order_relaxed);
+}
+
+
+// private methods
+
+bool CRateLimiter::TakeToken(const QByteArray& clientKey, RequestCost cost, qint64 nowNs)
+{
+	Shard& shard = GetShard(clientKey);
+
+	QMutexLocker lock(&shard.mutex);
+
+	QHash<QByteArray, Bucket>::iterator bucketIter = shard.buckets.find(clientKey);
+	if (bucketIter == shard.buckets.end()){
+		if (shard.buckets.size() >= qMax(1, m_config.maxTrackedKeys / s_shardCount)){
+			EvictFullBuckets(shard, nowNs);
+		}
+
+		Bucket bucket;
+		bucket.cheapTokens = m_config.cheapBurst;
+		bucket.expensiveTokens = m_config.expensiveBurst;
+		bucket.lastRefillNs = nowNs;
+
+		bucketIter = shard.buckets.insert(clientKey, bucket);
+	}
+	else{
+		Refill(*bucketIter, nowNs);
+	}
+
+	double& tokens = (cost == RequestCost::Expensive) ? bucketIter->expensiveTokens : bucketIter->cheapTokens;
+	if (tokens < 1.0){
+		return false;
+	}
+
+	tokens -= 1.0;
+
+	return true;
+}
+
+
+void CRateLimiter::ReturnToken(const QByteArray& clientKey, RequestCost cost)
+{
+	Shard& shard = GetShard(clientKey);
+
+	QMutexLocker lock(&shard.mutex);
+
+	QHash<QByteArray, Bucket>::iterator bucketIter = shard.buckets.find(clientKey);
+	if (bucketIter != shard.buckets.end()){
+		if (cost == RequestCost::Expensive){
+			bucketIter->expensiveTokens = qMin(bucketIter->expensiveTokens + 1.0, double(m_config.expensiveBurst));
+		}
+		else{
+			bucketIter->cheapTokens = qMin(bucketIter->cheapTokens + 1.0, double(m_config.cheapBurst));
+		}
+	}
+}
+
+
+void CRateLimiter::Refill(Bucket& bucket, qint64 nowNs) const
+{
+	double elapsedSeconds = (nowNs - bucket.lastRefillNs) / 1e9;
+	bucket.lastRefillNs = nowNs;
+
+	bucket.cheapTokens = qMin(bucket.cheapTokens + elapsedSeconds * m_config.cheapRequestsPerSecond, double(m_config.cheapBurst));
+	bucket.expensiveTokens = qMin(bucket.expensiveTokens + elapsedSeconds * m_config.expensiveRequestsPerSecond, double(m_config.expensiveBurst));
+}
+
+
+void CRateLimiter::EvictFullBuckets(Shard& shard, qint64 nowNs)
+{
+	// A full bucket is indistinguishable from a new one, dropping it loses nothing
+	QHash<QByteArray, Bucket>::iterator bucketIter = shard.buckets.begin();
+	while (bucketIter != shard.buckets.end()){
+		Refill(*bucketIter, nowNs);
+
+		if (bucketIter->cheapTokens >= m_config.cheapBurst && bucketIter->expensiveTokens >= m_config.expensiveBurst){
+			bucketIter = shard.buckets.erase(bucketIter);
+		}
+		else{
+			++bucketIter;
+		}
+	}
+}
+
+
+CRateLimiter::Shard& CRateLimiter::GetShard(const QByteArray& clientKey)
+{
+	return m_shards[qHash(clientKey) % s_shardCount];
+}
+
+
+} // namespace AuthServerSdk
+
+
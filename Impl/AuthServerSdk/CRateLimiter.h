@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#pragma once
+
+
+// STL includes
+#include <atomic>
+
+// Qt includes
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QReadWriteLock>
+
+// AuthServerSdk includes
+#include <AuthServerSdk/AuthServerSdk.h>
+
+
+namespace AuthServerSdk
+{
+
+
+/**
+* @brief Token bucket rate limiter keyed by client identity.
+*
+* Every key (user, tenant, token or address) owns two buckets, one for cheap
+* and one for expensive requests, refilled continuously at the configured
+* rates. A request is admitted only if all of its keys have a token left;
+* otherwise the tokens already taken are returned and the request is
+* rejected immediately, so that an overloaded client is turned away instead
+* of occupying a worker.
+*
+* The buckets are spread over independently locked shards to keep the
+* contention between request threads low. Full buckets carry no state and
+* are dropped when a shard grows beyond its share of the key limit.
+*
+* Configure() may be called while requests are admitted; an Admit() call
+* runs completely with either the old or the new configuration.
+*
+* @note The limiter is internal to the SDK and is not exported.
+*/
+class CRateLimiter
+{
+public:
+	CRateLimiter();
+
+	void Configure(const RateLimitConfig& config);
+
+	/**
+	* @brief Takes one token for every key.
+	* @return true if the request is admitted; always true when the limiter is disabled.
+	*/
+	bool Admit(const QList<QByteArray>& clientKeys, RequestCost cost);
+
+	/**
+	* @brief Fills the rate limiter part of the server statistics.
+	*/
+	void GetStatistics(ServerStatistics& statistics) const;
+
+private:
+	struct Bucket
+	{
+		double cheapTokens = 0.0;
+		double expensiveTokens = 0.0;
+		qint64 lastRefillNs = 0;
+	};
+
+	struct Shard
+	{
+		QMutex mutex;
+		QHash<QByteArray, Bucket> buckets;
+	};
+
+	static const int s_shardCount = 16;
+
+	bool TakeToken(const QByteArray& clientKey, RequestCost cost, qint64 nowNs);
+	void ReturnToken(const QByteArray& clientKey, RequestCost cost);
+	void Refill(Bucket& bucket, qint64 nowNs) const;
+	void EvictFullBuckets(Shard& shard, qint64 nowNs);
+	Shard& GetShard(const QByteArray& clientKey);
+
+private:
+	// Written by Configure(), read by Admit() under the read lock
+	mutable QReadWriteLock m_configLock;
+	RateLimitConfig m_config;
+
+	QElapsedTimer m_clock;
+	Shard m_shards[s_shardCount];
+
+	std::atomic<qint64> m_admittedCount;
+	std::atomic<qint64> m_rejectedCount;
+};
+
+
+} // namespace AuthServerSdk
+
+
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#include <AuthServerSdk/CSslFileWatcher.h>
+
+
+// Qt includes
+#include <QtCore/QDebug>
+#include <QtCore/QFileInfo>
+
+
+namespace AuthServerSdk
+{
+
+
+// public methods
+
+CSslFileWatcher::CSslFileWatcher(const ChangeCallback& callback, int settleDelayMs)
+	:m_callback(callback)
+{
+	m_settleTimer.setSingleShot(true);
+	m_settleTimer.setInterval(settleDelayMs);
+
+	QObject::connect(&m_watcher, &QFileSystemWatcher::fileChanged, [this](const QString& filePath){
+		OnFileChanged(filePath);
+	});
+
+	QObject::connect(&m_settleTimer, &QTimer::timeout, [this](){
+		OnSettled();
+	});
+}
+
+
+void CSslFileWatcher::SetFilePaths(const QStringList& filePaths)
+{
+	m_settleTimer.stop();
+
+	QStringList watchedFiles = m_watcher.files();
+	if (!watchedFiles.isEmpty()){
+		m_watcher.removePaths(watchedFiles);
+	}
+
+	m_filePaths = filePaths;
+	m_filePaths.removeAll(QString());
+	m_filePaths.removeDuplicates();
+
+	for (const QString& filePath : m_filePaths){
+		if (!m_watcher.addPath(filePath)){
+			qWarning() << "Unable to watch SSL file" << filePath;
+		}
+	}
+}
+
+
+QStringList CSslFileWatcher::GetFilePaths() const
+{
+	return m_filePaths;
+}
+
+
+// private methods
+
+void CSslFileWatcher::OnFileChanged(const QString& filePath)
+{
+	qDebug() << "SSL file changed:" << filePath;
+
+	// Restart the delay on every change, the callback runs once the batch has settled
+	m_settleTimer.start();
+}
+
+
+void CSslFileWatcher::OnSettled()
+{
+	// Files replaced by rename are dropped from the watcher, add them again
+	QStringList watchedFiles = m_watcher.files();
+	for (const QString& filePath : m_filePaths){
+		if (!watchedFiles.contains(filePath) && QFileInfo::exists(filePath)){
+			m_watcher.addPath(filePath);
+		}
+	}
+
+	if (m_callback){
+		m_callback();
+	}
+}
+
+
+} // namespace AuthServerSdk
+
+
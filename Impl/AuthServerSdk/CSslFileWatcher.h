@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#pragma once
+
+
+// STL includes
+#include <functional>
+
+// Qt includes
+#include <QtCore/QFileSystemWatcher>
+#include <QtCore/QStringList>
+#include <QtCore/QTimer>
+
+
+namespace AuthServerSdk
+{
+
+
+/**
+* @brief Watches certificate and key files and reports settled changes.
+*
+* Certificate renewal tools usually replace the certificate and the key in
+* several steps (write temporary file, rename, write the next file). The
+* watcher therefore waits until no further change has been seen for the
+* settle delay before it invokes the callback once for the whole batch.
+* Replaced files are re-added to the watch list, because most platforms
+* stop watching a path once the original file has been removed.
+*
+* @note The watcher lives in the thread that created it and needs a running
+*       Qt event loop there.
+*/
+class CSslFileWatcher
+{
+public:
+	typedef std::function<void()> ChangeCallback;
+
+	explicit CSslFileWatcher(const ChangeCallback& callback, int settleDelayMs = 2000);
+
+	/**
+	* @brief Replaces the set of watched files.
+	*
+	* An empty list stops watching.
+	*/
+	void SetFilePaths(const QStringList& filePaths);
+
+	QStringList GetFilePaths() const;
+
+private:
+	void OnFileChanged(const QString& filePath);
+	void OnSettled();
+
+private:
+	ChangeCallback m_callback;
+	QStringList m_filePaths;
+	QFileSystemWatcher m_watcher;
+	QTimer m_settleTimer;
+};
+
+
+} // namespace AuthServerSdk
+
+
@@ -0,0 +1,922 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#include <AuthServerSdk/CSubscriptionFanOut.h>
+
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+
+// Qt includes
+#include <QtCore/QDateTime>
+#include <QtCore/QDebug>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QQueue>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QReadLocker>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+#include <QtCore/QWriteLocker>
+#include <QtWebSockets/QWebSocket>
+
+
+namespace AuthServerSdk
+{
+
+
+static const int s_maxSenderThreads = 8;
+static const int s_latencySampleCount = 1024;
+static const int s_timerTickMs = 100;
+static const char* const s_resyncMessage = "{\"type\":\"resync\"}";
+static const char* const s_sessionExpiredMessage = "{\"type\":\"sessionExpired\"}";
+
+
+template<typename Value>
+static void UpdateMaximum(std::atomic<Value>& maximum, Value value)
+{
+	Value current = maximum.load(std::memory_order_relaxed);
+	while (value > current && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed)){
+	}
+}
+
+
+/**
+* @brief Subscriber socket with its bounded send queue.
+*/
+class CSubscriptionFanOut::CConnection
+{
+public:
+	QWebSocket* socketPtr = nullptr;
+	QQueue<QByteArray> queue;
+
+	// The resync message still has to be sent, newer notifications are covered by the reload
+	bool isResyncPending = false;
+
+	// Fan-out clock times in milliseconds, -1 if not set
+	qint64 lastActivityMs = 0;
+	qint64 lastPingMs = -1;
+	qint64 sessionExpirationMs = -1;
+};
+
+
+/**
+* @brief Sender thread with the subscribers it owns.
+*
+* The subscriber map and the timer wheel are only accessed from the sender
+* thread; other threads reach them by queuing functions to the context object.
+*/
+class CSubscriptionFanOut::CSenderShard
+{
+public:
+	QThread thread;
+	QObject* contextPtr = nullptr;
+	QHash<qint64, CConnection*> subscribers;
+	std::atomic<int> subscriberCount{0};
+
+	// Heartbeat, idle and session expiry deadlines of all subscribers, advanced by one timer
+	CTimerWheel timerWheel{s_timerTickMs};
+};
+
+
+// public methods
+
+CSubscriptionFanOut::CSubscriptionFanOut()
+	:m_nextSubscriberId(0),
+	m_publishedCount(0),
+	m_deliveredCount(0),
+	m_maxQueuedNotifications(256),
+	m_maxBytesInFlight(64 * 1024),
+	m_slowConsumerPolicy(int(SlowConsumerPolicy::ResyncRequired)),
+	m_queueHighWaterMark(0),
+	m_droppedCount(0),
+	m_resyncCount(0),
+	m_disconnectedCount(0),
+	m_heartbeatIntervalMs(30000),
+	m_idleTimeoutMs(90000),
+	m_heartbeatCount(0),
+	m_idleClosedCount(0),
+	m_expiredSessionCount(0),
+	m_maxTimerTickUs(0),
+	m_coalescer([this](const CChangeCoalescer::Batch& batch){ PublishBatch(batch); }),
+	m_nextLatencySample(0)
+{
+	m_clock.start();
+}
+
+
+CSubscriptionFanOut::~CSubscriptionFanOut()
+{
+	// No batch may be released into the shards while they are deleted
+	m_coalescer.Stop();
+
+	DetachAll();
+
+	QVector<CSenderShard*> shards;
+	{
+		QWriteLocker lock(&m_shardsLock);
+		shards.swap(m_shards);
+	}
+
+	StopShards(shards);
+}
+
+
+void CSubscriptionFanOut::Configure(const NotificationConfig& config)
+{
+	m_maxQueuedNotifications.store(qMax(1, config.maxQueuedNotifications), std::memory_order_relaxed);
+	m_maxBytesInFlight.store(qMax(1, config.maxBytesInFlight), std::memory_order_relaxed);
+	m_slowConsumerPolicy.store(int(config.slowConsumerPolicy), std::memory_order_relaxed);
+	m_heartbeatIntervalMs.store(qMax(0, config.heartbeatIntervalMs), std::memory_order_relaxed);
+	m_idleTimeoutMs.store(qMax(0, config.idleTimeoutMs), std::memory_order_relaxed);
+
+	m_coalescer.Configure(config.coalescingWindowMs, config.maxCoalescingDelayMs);
+
+	int threadCount = (config.senderThreads > 0) ? config.senderThreads : GetDefaultSenderThreads();
+	{
+		QReadLocker lock(&m_shardsLock);
+		if (threadCount == m_shards.size()){
+			return;
+		}
+	}
+
+	{
+		QMutexLocker lock(&m_subscriberMutex);
+		if (!m_subscribers.isEmpty()){
+			qWarning() << "Notification sender threads are not changed while subscribers are attached";
+			return;
+		}
+	}
+
+	QVector<CSenderShard*> shards;
+	for (int index = 0; index < threadCount; ++index){
+		CSenderShard* shardPtr = new CSenderShard;
+		shardPtr->thread.setObjectName(QString("NotificationSender%1").arg(index));
+
+		shardPtr->contextPtr = new QObject;
+
+		QTimer* tickTimerPtr = new QTimer(shardPtr->contextPtr);
+		tickTimerPtr->setInterval(s_timerTickMs);
+		QObject::connect(tickTimerPtr, &QTimer::timeout, shardPtr->contextPtr, [this, shardPtr](){
+			ProcessTimers(shardPtr);
+		});
+
+		shardPtr->contextPtr->moveToThread(&shardPtr->thread);
+		QObject::connect(&shardPtr->thread, &QThread::started, tickTimerPtr, [tickTimerPtr](){
+			tickTimerPtr->start();
+		});
+		QObject::connect(&shardPtr->thread, &QThread::finished, shardPtr->contextPtr, &QObject::deleteLater);
+
+		shardPtr->thread.start();
+
+		shards.append(shardPtr);
+	}
+
+	{
+		// A subscriber may have been attached meanwhile; attaching holds the read lock until it is registered
+		QWriteLocker shardsLock(&m_shardsLock);
+		QMutexLocker subscribersLock(&m_subscriberMutex);
+
+		if (m_subscribers.isEmpty()){
+			m_shards.swap(shards);
+		}
+		else{
+			qWarning() << "Notification sender threads are not changed while subscribers are attached";
+		}
+	}
+
+	// Either the previous shards or the unused new ones, without subscribers in both cases
+	StopShards(shards);
+}
+
+
+qint64 CSubscriptionFanOut::AttachSubscriber(QWebSocket* socketPtr, const SubscriberContext& context)
+{
+	if (socketPtr == nullptr || socketPtr->state() != QAbstractSocket::ConnectedState){
+		return -1;
+	}
+
+	if (socketPtr->thread() != QThread::currentThread()){
+		qWarning() << "Subscriber socket must be attached from its own thread";
+		return -1;
+	}
+
+	QReadLocker shardsLock(&m_shardsLock);
+	if (m_shards.isEmpty()){
+		return -1;
+	}
+
+	// Least loaded sender thread
+	int shardIndex = 0;
+	for (int index = 1; index < m_shards.size(); ++index){
+		if (m_shards[index]->subscriberCount.load(std::memory_order_relaxed) < m_shards[shardIndex]->subscriberCount.load(std::memory_order_relaxed)){
+			shardIndex = index;
+		}
+	}
+
+	CSenderShard* shardPtr = m_shards[shardIndex];
+	qint64 subscriberId = m_nextSubscriberId.fetch_add(1, std::memory_order_relaxed) + 1;
+
+	{
+		QMutexLocker lock(&m_subscriberMutex);
+
+		Subscriber subscriber;
+		subscriber.shardIndex = shardIndex;
+		subscriber.context = context;
+		m_subscribers.insert(subscriberId, subscriber);
+
+		AddToIndex(subscriberId, context);
+	}
+	shardPtr->subscriberCount.fetch_add(1, std::memory_order_relaxed);
+
+	const qint64 sessionExpirationMs = GetSessionExpirationMs(context);
+
+	// Only a socket without parent can change its thread
+	socketPtr->setParent(nullptr);
+	socketPtr->moveToThread(&shardPtr->thread);
+
+	QMetaObject::invokeMethod(shardPtr->contextPtr, [this, shardPtr, subscriberId, socketPtr, sessionExpirationMs](){
+		socketPtr->setParent(shardPtr->contextPtr);
+
+		CConnection* connectionPtr = new CConnection;
+		connectionPtr->socketPtr = socketPtr;
+		connectionPtr->lastActivityMs = m_clock.elapsed();
+		connectionPtr->sessionExpirationMs = sessionExpirationMs;
+		shardPtr->subscribers.insert(subscriberId, connectionPtr);
+
+		QObject::connect(socketPtr, &QWebSocket::disconnected, shardPtr->contextPtr, [this, shardPtr, subscriberId](){
+			RemoveSubscriber(shardPtr, subscriberId);
+		});
+
+		QObject::connect(socketPtr, &QWebSocket::bytesWritten, shardPtr->contextPtr, [this, connectionPtr](){
+			Drain(connectionPtr);
+		});
+
+		// Any frame from the client, including the answer to a ping, shows the connection is alive
+		auto updateActivity = [this, connectionPtr](){
+			connectionPtr->lastActivityMs = m_clock.elapsed();
+		};
+		QObject::connect(socketPtr, &QWebSocket::pong, shardPtr->contextPtr, updateActivity);
+		QObject::connect(socketPtr, &QWebSocket::textMessageReceived, shardPtr->contextPtr, updateActivity);
+		QObject::connect(socketPtr, &QWebSocket::binaryMessageReceived, shardPtr->contextPtr, updateActivity);
+
+		ScheduleTimer(shardPtr, subscriberId, connectionPtr);
+
+		// The connection may have been lost while the socket was handed over
+		if (socketPtr->state() != QAbstractSocket::ConnectedState){
+			RemoveSubscriber(shardPtr, subscriberId);
+		}
+	}, Qt::QueuedConnection);
+
+	return subscriberId;
+}
+
+
+bool CSubscriptionFanOut::UpdateSubscriberContext(qint64 subscriberId, const SubscriberContext& context)
+{
+	int shardIndex = -1;
+	{
+		QMutexLocker lock(&m_subscriberMutex);
+
+		QHash<qint64, Subscriber>::iterator subscriberIter = m_subscribers.find(subscriberId);
+		if (subscriberIter == m_subscribers.end()){
+			return false;
+		}
+
+		RemoveFromIndex(subscriberId, subscriberIter->context);
+		subscriberIter->context = context;
+		AddToIndex(subscriberId, context);
+
+		shardIndex = subscriberIter->shardIndex;
+	}
+
+	// The session expiry is checked by the sender thread
+	QReadLocker shardsLock(&m_shardsLock);
+
+	CSenderShard* shardPtr = m_shards.value(shardIndex);
+	if (shardPtr != nullptr){
+		const qint64 sessionExpirationMs = GetSessionExpirationMs(context);
+
+		QMetaObject::invokeMethod(shardPtr->contextPtr, [this, shardPtr, subscriberId, sessionExpirationMs](){
+			CConnection* connectionPtr = shardPtr->subscribers.value(subscriberId);
+			if (connectionPtr != nullptr){
+				connectionPtr->sessionExpirationMs = sessionExpirationMs;
+				ScheduleTimer(shardPtr, subscriberId, connectionPtr);
+			}
+		}, Qt::QueuedConnection);
+	}
+
+	return true;
+}
+
+
+void CSubscriptionFanOut::DetachSubscriber(qint64 subscriberId)
+{
+	int shardIndex = -1;
+	{
+		QMutexLocker lock(&m_subscriberMutex);
+		shardIndex = m_subscribers.value(subscriberId).shardIndex;
+	}
+
+	QReadLocker shardsLock(&m_shardsLock);
+	if (shardIndex < 0 || shardIndex >= m_shards.size()){
+		return;
+	}
+
+	CSenderShard* shardPtr = m_shards[shardIndex];
+	QMetaObject::invokeMethod(shardPtr->contextPtr, [this, shardPtr, subscriberId](){
+		CConnection* connectionPtr = shardPtr->subscribers.value(subscriberId);
+		if (connectionPtr != nullptr){
+			connectionPtr->socketPtr->close();
+			RemoveSubscriber(shardPtr, subscriberId);
+		}
+	}, Qt::QueuedConnection);
+}
+
+
+void CSubscriptionFanOut::DetachAll()
+{
+	// Queued in front of the close requests, so the subscribers still receive them
+	m_coalescer.Flush();
+
+	QReadLocker shardsLock(&m_shardsLock);
+	for (CSenderShard* shardPtr : m_shards){
+		QMetaObject::invokeMethod(shardPtr->contextPtr, [this, shardPtr](){
+			const QList<qint64> subscriberIds = shardPtr->subscribers.keys();
+			for (qint64 subscriberId : subscriberIds){
+				shardPtr->subscribers.value(subscriberId)->socketPtr->close();
+				RemoveSubscriber(shardPtr, subscriberId);
+			}
+		}, Qt::BlockingQueuedConnection);
+	}
+}
+
+
+void CSubscriptionFanOut::FlushPending()
+{
+	m_coalescer.Flush();
+}
+
+
+bool CSubscriptionFanOut::HasPendingMessages() const
+{
+	bool hasPendingMessages = false;
+
+	QReadLocker shardsLock(&m_shardsLock);
+	for (CSenderShard* shardPtr : m_shards){
+		// Runs after the deliveries already queued to the sender thread
+		QMetaObject::invokeMethod(shardPtr->contextPtr, [shardPtr, &hasPendingMessages](){
+			const QHash<qint64, CConnection*>& subscribers = shardPtr->subscribers;
+			for (const CConnection* connectionPtr : subscribers){
+				if (!connectionPtr->queue.isEmpty() || connectionPtr->isResyncPending || connectionPtr->socketPtr->bytesToWrite() > 0){
+					hasPendingMessages = true;
+					return;
+				}
+			}
+		}, Qt::BlockingQueuedConnection);
+
+		if (hasPendingMessages){
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void CSubscriptionFanOut::CloseAll(int windowMs)
+{
+	const int boundedWindowMs = qMax(0, windowMs);
+
+	QReadLocker shardsLock(&m_shardsLock);
+	for (CSenderShard* shardPtr : m_shards){
+		QMetaObject::invokeMethod(shardPtr->contextPtr, [shardPtr, boundedWindowMs](){
+			const QList<qint64> subscriberIds = shardPtr->subscribers.keys();
+			for (qint64 subscriberId : subscriberIds){
+				QTimer::singleShot(int(QRandomGenerator::global()->bounded(boundedWindowMs + 1)), shardPtr->contextPtr, [shardPtr, subscriberId](){
+					// Removed by the disconnected handler once the client has answered
+					CConnection* connectionPtr = shardPtr->subscribers.value(subscriberId);
+					if (connectionPtr != nullptr){
+						connectionPtr->socketPtr->close(QWebSocketProtocol::CloseCodeGoingAway, "Server is shutting down");
+					}
+				});
+			}
+		}, Qt::QueuedConnection);
+	}
+}
+
+
+int CSubscriptionFanOut::GetSubscriberCount() const
+{
+	int subscriberCount = 0;
+
+	QReadLocker shardsLock(&m_shardsLock);
+	for (const CSenderShard* shardPtr : m_shards){
+		subscriberCount += shardPtr->subscriberCount.load(std::memory_order_relaxed);
+	}
+
+	return subscriberCount;
+}
+
+
+void CSubscriptionFanOut::Publish(const ChangeNotification& notification)
+{
+	m_publishedCount.fetch_add(1, std::memory_order_relaxed);
+
+	if (m_coalescer.Add(notification)){
+		return;
+	}
+
+	const qint64 publishedNs = m_clock.nsecsElapsed();
+
+	QHash<int, QVector<qint64>> recipientsByShard;
+	if (CollectRecipients(notification, recipientsByShard)){
+		// Serialized and encoded once, every sender thread shares the same buffer
+		Deliver(recipientsByShard, Serialize(notification), publishedNs);
+	}
+}
+
+
+void CSubscriptionFanOut::GetStatistics(ServerStatistics& statistics) const
+{
+	statistics.subscribers = GetSubscriberCount();
+	statistics.publishedChanges = m_publishedCount.load(std::memory_order_relaxed);
+	statistics.deliveredNotifications = m_deliveredCount.load(std::memory_order_relaxed);
+	statistics.subscriberQueueHighWaterMark = m_queueHighWaterMark.load(std::memory_order_relaxed);
+	statistics.droppedNotifications = m_droppedCount.load(std::memory_order_relaxed);
+	statistics.resyncRequests = m_resyncCount.load(std::memory_order_relaxed);
+	statistics.disconnectedSlowSubscribers = m_disconnectedCount.load(std::memory_order_relaxed);
+	statistics.coalescedChanges = m_coalescer.GetCoalescedCount();
+	statistics.heartbeatsSent = m_heartbeatCount.load(std::memory_order_relaxed);
+	statistics.idleSubscribersClosed = m_idleClosedCount.load(std::memory_order_relaxed);
+	statistics.expiredSubscriberSessions = m_expiredSessionCount.load(std::memory_order_relaxed);
+	statistics.maxTimerTickMs = m_maxTimerTickUs.load(std::memory_order_relaxed) / 1000.0;
+
+	QVector<qint64> samples;
+	{
+		QMutexLocker lock(&m_latencyMutex);
+		samples = m_latencySamplesUs;
+	}
+
+	if (samples.isEmpty()){
+		return;
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	auto percentileMs = [&samples](double percentile){
+		int index = qBound(0, int(std::ceil(percentile * samples.size())) - 1, samples.size() - 1);
+
+		return samples[index] / 1000.0;
+	};
+
+	statistics.fanOutLatencyP50Ms = percentileMs(0.50);
+	statistics.fanOutLatencyP95Ms = percentileMs(0.95);
+	statistics.fanOutLatencyP99Ms = percentileMs(0.99);
+}
+
+
+int CSubscriptionFanOut::GetDefaultSenderThreads()
+{
+	return qBound(1, QThread::idealThreadCount(), s_maxSenderThreads);
+}
+
+
+// private methods
+
+void CSubscriptionFanOut::StopShards(QVector<CSenderShard*>& shards)
+{
+	for (CSenderShard* shardPtr : shards){
+		shardPtr->thread.quit();
+		shardPtr->thread.wait();
+
+		delete shardPtr;
+	}
+
+	shards.clear();
+}
+
+
+void CSubscriptionFanOut::PublishBatch(const CChangeCoalescer::Batch& batch)
+{
+	// Tenant, collection and permission are shared by all changes of the batch
+	ChangeNotification notification;
+	notification.collectionId = batch.collectionId;
+	notification.tenantId = batch.tenantId;
+	notification.requiredPermission = batch.requiredPermission;
+
+	// Latency is measured from the release of the batch, the coalescing window is intended delay
+	const qint64 publishedNs = m_clock.nsecsElapsed();
+
+	QHash<int, QVector<qint64>> recipientsByShard;
+	if (CollectRecipients(notification, recipientsByShard)){
+		Deliver(recipientsByShard, Serialize(batch), publishedNs);
+	}
+}
+
+
+bool CSubscriptionFanOut::CollectRecipients(const ChangeNotification& notification, QHash<int, QVector<qint64>>& recipientsByShard) const
+{
+	QMutexLocker lock(&m_subscriberMutex);
+
+	QSet<qint64> candidates;
+	CollectCandidates(notification, candidates);
+
+	for (qint64 subscriberId : candidates){
+		QHash<qint64, Subscriber>::const_iterator subscriberIter = m_subscribers.constFind(subscriberId);
+		if (subscriberIter != m_subscribers.constEnd() && IsVisible(notification, subscriberIter->context)){
+			recipientsByShard[subscriberIter->shardIndex].append(subscriberId);
+		}
+	}
+
+	return !recipientsByShard.isEmpty();
+}
+
+
+void CSubscriptionFanOut::Deliver(const QHash<int, QVector<qint64>>& recipientsByShard, const QByteArray& message, qint64 publishedNs)
+{
+	QReadLocker shardsLock(&m_shardsLock);
+	for (QHash<int, QVector<qint64>>::const_iterator shardIter = recipientsByShard.constBegin(); shardIter != recipientsByShard.constEnd(); ++shardIter){
+		CSenderShard* shardPtr = m_shards.value(shardIter.key());
+		if (shardPtr == nullptr){
+			continue;
+		}
+
+		const QVector<qint64> recipients = shardIter.value();
+		QMetaObject::invokeMethod(shardPtr->contextPtr, [this, shardPtr, recipients, message, publishedNs](){
+			for (qint64 subscriberId : recipients){
+				Enqueue(shardPtr, subscriberId, message);
+			}
+
+			RecordLatency((m_clock.nsecsElapsed() - publishedNs) / 1000);
+		}, Qt::QueuedConnection);
+	}
+}
+
+
+void CSubscriptionFanOut::RemoveSubscriber(CSenderShard* shardPtr, qint64 subscriberId)
+{
+	CConnection* connectionPtr = shardPtr->subscribers.take(subscriberId);
+	if (connectionPtr == nullptr){
+		return;
+	}
+
+	shardPtr->timerWheel.Cancel(subscriberId);
+
+	// No more callbacks into the connection that is deleted now
+	QWebSocket* socketPtr = connectionPtr->socketPtr;
+	QObject::disconnect(socketPtr, nullptr, shardPtr->contextPtr, nullptr);
+	delete connectionPtr;
+
+	shardPtr->subscriberCount.fetch_sub(1, std::memory_order_relaxed);
+
+	{
+		QMutexLocker lock(&m_subscriberMutex);
+
+		QHash<qint64, Subscriber>::iterator subscriberIter = m_subscribers.find(subscriberId);
+		if (subscriberIter != m_subscribers.end()){
+			RemoveFromIndex(subscriberId, subscriberIter->context);
+			m_subscribers.erase(subscriberIter);
+		}
+	}
+
+	socketPtr->deleteLater();
+}
+
+
+void CSubscriptionFanOut::Enqueue(CSenderShard* shardPtr, qint64 subscriberId, const QByteArray& message)
+{
+	// Subscribers removed after publishing are skipped
+	CConnection* connectionPtr = shardPtr->subscribers.value(subscriberId);
+	if (connectionPtr == nullptr){
+		return;
+	}
+
+	if (connectionPtr->isResyncPending){
+		m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	connectionPtr->queue.enqueue(message);
+
+	if (connectionPtr->queue.size() > m_maxQueuedNotifications.load(std::memory_order_relaxed)){
+		switch (SlowConsumerPolicy(m_slowConsumerPolicy.load(std::memory_order_relaxed))){
+		case SlowConsumerPolicy::ResyncRequired:
+			m_droppedCount.fetch_add(connectionPtr->queue.size(), std::memory_order_relaxed);
+			m_resyncCount.fetch_add(1, std::memory_order_relaxed);
+			connectionPtr->queue.clear();
+			connectionPtr->isResyncPending = true;
+			break;
+
+		case SlowConsumerPolicy::DropOldest:
+			m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+			connectionPtr->queue.dequeue();
+			break;
+
+		case SlowConsumerPolicy::Disconnect:
+			m_droppedCount.fetch_add(connectionPtr->queue.size(), std::memory_order_relaxed);
+			m_disconnectedCount.fetch_add(1, std::memory_order_relaxed);
+			qDebug() << "Slow notification subscriber" << subscriberId << "disconnected";
+			connectionPtr->socketPtr->abort();
+			RemoveSubscriber(shardPtr, subscriberId);
+			return;
+		}
+	}
+
+	Drain(connectionPtr);
+
+	// What stays queued after draining is the backlog of this subscriber
+	UpdateMaximum(m_queueHighWaterMark, int(connectionPtr->queue.size()));
+}
+
+
+void CSubscriptionFanOut::Drain(CConnection* connectionPtr)
+{
+	const int maxBytesInFlight = m_maxBytesInFlight.load(std::memory_order_relaxed);
+
+	// The socket counts its unwritten bytes as encoded frames, headers included
+	QWebSocket* socketPtr = connectionPtr->socketPtr;
+
+	if (connectionPtr->isResyncPending){
+		if (socketPtr->bytesToWrite() >= maxBytesInFlight){
+			return;
+		}
+
+		socketPtr->sendBinaryMessage(QByteArray(s_resyncMessage));
+		connectionPtr->isResyncPending = false;
+	}
+
+	// Binary frames take the UTF-8 JSON as it is, a text frame would re-encode it for every subscriber
+	while (!connectionPtr->queue.isEmpty() && socketPtr->bytesToWrite() < maxBytesInFlight){
+		socketPtr->sendBinaryMessage(connectionPtr->queue.dequeue());
+		m_deliveredCount.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+
+void CSubscriptionFanOut::ScheduleTimer(CSenderShard* shardPtr, qint64 subscriberId, const CConnection* connectionPtr)
+{
+	qint64 nextMs = -1;
+	auto consider = [&nextMs](qint64 timeMs){
+		if (nextMs < 0 || timeMs < nextMs){
+			nextMs = timeMs;
+		}
+	};
+
+	const int heartbeatIntervalMs = m_heartbeatIntervalMs.load(std::memory_order_relaxed);
+	if (heartbeatIntervalMs > 0){
+		consider(qMax(connectionPtr->lastActivityMs, connectionPtr->lastPingMs) + heartbeatIntervalMs);
+	}
+
+	const int idleTimeoutMs = m_idleTimeoutMs.load(std::memory_order_relaxed);
+	if (idleTimeoutMs > 0){
+		consider(connectionPtr->lastActivityMs + idleTimeoutMs);
+	}
+
+	if (connectionPtr->sessionExpirationMs >= 0){
+		consider(connectionPtr->sessionExpirationMs);
+	}
+
+	if (nextMs < 0){
+		shardPtr->timerWheel.Cancel(subscriberId);
+	}
+	else{
+		shardPtr->timerWheel.Schedule(subscriberId, nextMs);
+	}
+}
+
+
+void CSubscriptionFanOut::ProcessTimers(CSenderShard* shardPtr)
+{
+	QElapsedTimer tickTimer;
+	tickTimer.start();
+
+	const qint64 nowMs = m_clock.elapsed();
+	const int heartbeatIntervalMs = m_heartbeatIntervalMs.load(std::memory_order_relaxed);
+	const int idleTimeoutMs = m_idleTimeoutMs.load(std::memory_order_relaxed);
+
+	// Activity does not touch the wheel; a due entry re-evaluates the connection and is rescheduled
+	const QVector<qint64> dueIds = shardPtr->timerWheel.Advance(nowMs);
+	for (qint64 subscriberId : dueIds){
+		CConnection* connectionPtr = shardPtr->subscribers.value(subscriberId);
+		if (connectionPtr == nullptr){
+			continue;
+		}
+
+		if (connectionPtr->sessionExpirationMs >= 0 && nowMs >= connectionPtr->sessionExpirationMs){
+			m_expiredSessionCount.fetch_add(1, std::memory_order_relaxed);
+			connectionPtr->socketPtr->sendBinaryMessage(QByteArray(s_sessionExpiredMessage));
+			connectionPtr->socketPtr->close(QWebSocketProtocol::CloseCodePolicyViolated, "Session expired");
+			RemoveSubscriber(shardPtr, subscriberId);
+
+			continue;
+		}
+
+		if (idleTimeoutMs > 0 && nowMs - connectionPtr->lastActivityMs >= idleTimeoutMs){
+			m_idleClosedCount.fetch_add(1, std::memory_order_relaxed);
+			qDebug() << "Idle notification subscriber" << subscriberId << "closed";
+			connectionPtr->socketPtr->abort();
+			RemoveSubscriber(shardPtr, subscriberId);
+
+			continue;
+		}
+
+		if (heartbeatIntervalMs > 0 && nowMs >= qMax(connectionPtr->lastActivityMs, connectionPtr->lastPingMs) + heartbeatIntervalMs){
+			m_heartbeatCount.fetch_add(1, std::memory_order_relaxed);
+			connectionPtr->socketPtr->ping();
+			connectionPtr->lastPingMs = nowMs;
+		}
+
+		ScheduleTimer(shardPtr, subscriberId, connectionPtr);
+	}
+
+	UpdateMaximum(m_maxTimerTickUs, tickTimer.nsecsElapsed() / 1000);
+}
+
+
+qint64 CSubscriptionFanOut::GetSessionExpirationMs(const SubscriberContext& context) const
+{
+	if (!context.sessionExpiration.isValid()){
+		return -1;
+	}
+
+	const qint64 remainingMs = QDateTime::currentDateTimeUtc().msecsTo(context.sessionExpiration);
+
+	return qMax(qint64(0), m_clock.elapsed() + remainingMs);
+}
+
+
+void CSubscriptionFanOut::AddToIndex(qint64 subscriberId, const SubscriberContext& context)
+{
+	QByteArray tenantId;
+	const bool hasTenant = GetIndexTenant(context, tenantId);
+
+	if (context.collectionIds.isEmpty()){
+		if (hasTenant){
+			m_tenantIndex[GetIndexKey(tenantId, QByteArray())].insert(subscriberId);
+		}
+		m_collectionIndex[QByteArray()].insert(subscriberId);
+
+		return;
+	}
+
+	for (const QByteArray& collectionId : context.collectionIds){
+		if (hasTenant){
+			m_tenantIndex[GetIndexKey(tenantId, collectionId)].insert(subscriberId);
+		}
+		m_collectionIndex[collectionId].insert(subscriberId);
+	}
+}
+
+
+void CSubscriptionFanOut::RemoveFromIndex(qint64 subscriberId, const SubscriberContext& context)
+{
+	auto removeEntry = [subscriberId](SubscriberIndex& index, const QByteArray& key){
+		SubscriberIndex::iterator entryIter = index.find(key);
+		if (entryIter != index.end()){
+			entryIter->remove(subscriberId);
+			if (entryIter->isEmpty()){
+				index.erase(entryIter);
+			}
+		}
+	};
+
+	QByteArray tenantId;
+	const bool hasTenant = GetIndexTenant(context, tenantId);
+
+	if (context.collectionIds.isEmpty()){
+		if (hasTenant){
+			removeEntry(m_tenantIndex, GetIndexKey(tenantId, QByteArray()));
+		}
+		removeEntry(m_collectionIndex, QByteArray());
+
+		return;
+	}
+
+	for (const QByteArray& collectionId : context.collectionIds){
+		if (hasTenant){
+			removeEntry(m_tenantIndex, GetIndexKey(tenantId, collectionId));
+		}
+		removeEntry(m_collectionIndex, collectionId);
+	}
+}
+
+
+void CSubscriptionFanOut::CollectCandidates(const ChangeNotification& notification, QSet<qint64>& candidates) const
+{
+	auto collect = [&candidates](const SubscriberIndex& index, const QByteArray& key){
+		SubscriberIndex::const_iterator entryIter = index.constFind(key);
+		if (entryIter != index.constEnd()){
+			candidates.unite(*entryIter);
+		}
+	};
+
+	if (notification.tenantId.isEmpty()){
+		// Shared objects are visible in every tenant
+		collect(m_collectionIndex, notification.collectionId);
+		collect(m_collectionIndex, QByteArray());
+
+		return;
+	}
+
+	// Own tenant, and subscribers of all tenants
+	collect(m_tenantIndex, GetIndexKey(notification.tenantId, notification.collectionId));
+	collect(m_tenantIndex, GetIndexKey(notification.tenantId, QByteArray()));
+	collect(m_tenantIndex, GetIndexKey(QByteArray(), notification.collectionId));
+	collect(m_tenantIndex, GetIndexKey(QByteArray(), QByteArray()));
+}
+
+
+bool CSubscriptionFanOut::IsVisible(const ChangeNotification& notification, const SubscriberContext& context)
+{
+	// Tenant and collection are already matched by the index
+	return notification.requiredPermission.isEmpty() || context.permissions.contains(notification.requiredPermission);
+}
+
+
+bool CSubscriptionFanOut::GetIndexTenant(const SubscriberContext& context, QByteArray& tenantId)
+{
+	// A subscriber without tenant only sees shared objects, found through the collection index
+	if (context.allTenants){
+		tenantId.clear();
+
+		return true;
+	}
+
+	tenantId = context.tenantId;
+
+	return !tenantId.isEmpty();
+}
+
+
+QByteArray CSubscriptionFanOut::GetIndexKey(const QByteArray& tenantId, const QByteArray& collectionId)
+{
+	return tenantId + '\n' + collectionId;
+}
+
+
+void CSubscriptionFanOut::RecordLatency(qint64 latencyUs)
+{
+	QMutexLocker lock(&m_latencyMutex);
+
+	if (m_latencySamplesUs.size() < s_latencySampleCount){
+		m_latencySamplesUs.append(latencyUs);
+	}
+	else{
+		m_latencySamplesUs[m_nextLatencySample] = latencyUs;
+		m_nextLatencySample = (m_nextLatencySample + 1) % s_latencySampleCount;
+	}
+}
+
+
+QByteArray CSubscriptionFanOut::Serialize(const ChangeNotification& notification)
+{
+	QJsonObject message;
+	message["type"] = "change";
+	message["collectionId"] = QString::fromUtf8(notification.collectionId);
+	message["objectId"] = QString::fromUtf8(notification.objectId);
+	message["operation"] = QString::fromUtf8(notification.operation);
+	if (!notification.tenantId.isEmpty()){
+		message["tenantId"] = QString::fromUtf8(notification.tenantId);
+	}
+
+	return QJsonDocument(message).toJson(QJsonDocument::Compact);
+}
+
+
+QByteArray CSubscriptionFanOut::Serialize(const CChangeCoalescer::Batch& batch)
+{
+	if (batch.objectIds.size() == 1){
+		// A single change keeps the format of uncoalesced notifications
+		ChangeNotification notification;
+		notification.collectionId = batch.collectionId;
+		notification.objectId = batch.objectIds.first();
+		notification.operation = batch.operations.first();
+		notification.tenantId = batch.tenantId;
+
+		return Serialize(notification);
+	}
+
+	QJsonArray changes;
+	for (int index = 0; index < batch.objectIds.size(); ++index){
+		QJsonObject change;
+		change["objectId"] = QString::fromUtf8(batch.objectIds[index]);
+		change["operation"] = QString::fromUtf8(batch.operations[index]);
+		changes.append(change);
+	}
+
+	QJsonObject message;
+	message["type"] = "changes";
+	message["collectionId"] = QString::fromUtf8(batch.collectionId);
+	message["changes"] = changes;
+	if (!batch.tenantId.isEmpty()){
+		message["tenantId"] = QString::fromUtf8(batch.tenantId);
+	}
+
+	return QJsonDocument(message).toJson(QJsonDocument::Compact);
+}
+
+
+} // namespace AuthServerSdk
+
+
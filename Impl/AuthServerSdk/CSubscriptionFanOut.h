@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#pragma once
+
+
+// STL includes
+#include <atomic>
+
+// Qt includes
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+
+// AuthServerSdk includes
+#include <AuthServerSdk/AuthServerSdk.h>
+#include <AuthServerSdk/CChangeCoalescer.h>
+#include <AuthServerSdk/CTimerWheel.h>
+
+
+namespace AuthServerSdk
+{
+
+
+/**
+* @brief Delivers change notifications to WebSocket subscribers from sender threads.
+*
+* Subscriber sockets are distributed over a small set of sender threads and
+* moved into them, so each socket is only ever touched by its own thread. A
+* published notification is serialized once into UTF-8 JSON; the implicitly
+* shared buffer is handed to every sender thread that has subscribers, which
+* writes it to all of them in one batch as a binary frame, so the payload is
+* not encoded again per subscriber. The publishing thread therefore
+* does not block on the number of connections, and one slow batch only
+* delays the subscribers of its own thread.
+*
+* Recipients are selected on the publishing side from an index of the
+* subscribers by tenant and by collection, so a notification only costs
+* work for the subscribers that may see it. Each sender thread receives the
+* IDs of its recipients together with the message.
+*
+* Every subscriber has a bounded send queue. Messages are handed to the
+* socket only while its unsent bytes stay below a limit; the remainder waits
+* in the queue and is drained as the socket reports written bytes. When the
+* queue of a slow subscriber is full, the configured SlowConsumerPolicy
+* applies, so memory does not grow with the backlog of a bad link.
+*
+* With a coalescing window configured, published notifications are first
+* merged per collection by a CChangeCoalescer and each released batch is
+* sent as one message listing the changed objects.
+*
+* Heartbeats, idle timeouts and session expiry share one deadline per
+* subscriber in a CTimerWheel of its sender thread, advanced by a single
+* timer per thread. A due subscriber is pinged, closed or rescheduled;
+* received frames only update its activity time, so traffic does not
+* touch the wheel.
+*
+* For every batch the time from publishing until the last write of the
+* batch is recorded, the percentiles over the most recent batches are
+* reported in the statistics.
+*
+* @note The fan-out is internal to the SDK and is not exported.
+*/
+class CSubscriptionFanOut
+{
+public:
+	CSubscriptionFanOut();
+	~CSubscriptionFanOut();
+
+	/**
+	* @brief Creates the sender threads and sets queue limits and coalescing.
+	*
+	* The thread count is only changed while no subscriber is attached. The
+	* new threads replace the previous ones under the shard lock, so
+	* concurrent Publish() calls see either set.
+	* Must be called from the thread that owns the server.
+	*/
+	void Configure(const NotificationConfig& config);
+
+	/**
+	* @brief Takes over a connected socket as subscriber.
+	* @return Subscriber ID, or -1 if the socket cannot be attached.
+	*/
+	qint64 AttachSubscriber(QWebSocket* socketPtr, const SubscriberContext& context);
+
+	/**
+	* @brief Replaces tenant, collections and permissions of a subscriber. Thread-safe.
+	*/
+	bool UpdateSubscriberContext(qint64 subscriberId, const SubscriberContext& context);
+
+	void DetachSubscriber(qint64 subscriberId);
+
+	/**
+	* @brief Releases pending batches, closes all subscriber connections and waits until they are removed.
+	*/
+	void DetachAll();
+
+	/**
+	* @brief Releases the pending coalesced batches into the send queues.
+	*/
+	void FlushPending();
+
+	/**
+	* @brief Returns true while a subscriber still has queued or unwritten messages.
+	*
+	* Waits briefly for every sender thread, must not be called from one.
+	*/
+	bool HasPendingMessages() const;
+
+	/**
+	* @brief Sends a close frame to every subscriber at a random time within @p windowMs.
+	*
+	* Subscribers are removed once their connection is closed.
+	*/
+	void CloseAll(int windowMs);
+
+	int GetSubscriberCount() const;
+
+	/**
+	* @brief Queues a notification for the matching subscribers. Thread-safe.
+	*/
+	void Publish(const ChangeNotification& notification);
+
+	/**
+	* @brief Fills the notification part of the server statistics.
+	*/
+	void GetStatistics(ServerStatistics& statistics) const;
+
+	/**
+	* @brief Default number of sender threads derived from the CPU core count.
+	*/
+	static int GetDefaultSenderThreads();
+
+private:
+	class CSenderShard;
+	class CConnection;
+
+	struct Subscriber
+	{
+		int shardIndex = -1;
+		SubscriberContext context;
+	};
+
+	typedef QHash<QByteArray, QSet<qint64>> SubscriberIndex;
+
+	static void StopShards(QVector<CSenderShard*>& shards);
+	void PublishBatch(const CChangeCoalescer::Batch& batch);
+	bool CollectRecipients(const ChangeNotification& notification, QHash<int, QVector<qint64>>& recipientsByShard) const;
+	void Deliver(const QHash<int, QVector<qint64>>& recipientsByShard, const QByteArray& message, qint64 publishedNs);
+	void RemoveSubscriber(CSenderShard* shardPtr, qint64 subscriberId);
+	void Enqueue(CSenderShard* shardPtr, qint64 subscriberId, const QByteArray& message);
+	void Drain(CConnection* connectionPtr);
+	void ScheduleTimer(CSenderShard* shardPtr, qint64 subscriberId, const CConnection* connectionPtr);
+	void ProcessTimers(CSenderShard* shardPtr);
+	qint64 GetSessionExpirationMs(const SubscriberContext& context) const;
+	void AddToIndex(qint64 subscriberId, const SubscriberContext& context);
+	void RemoveFromIndex(qint64 subscriberId, const SubscriberContext& context);
+	void CollectCandidates(const ChangeNotification& notification, QSet<qint64>& candidates) const;
+	static bool IsVisible(const ChangeNotification& notification, const SubscriberContext& context);
+	static bool GetIndexTenant(const SubscriberContext& context, QByteArray& tenantId);
+	static QByteArray GetIndexKey(const QByteArray& tenantId, const QByteArray& collectionId);
+	void RecordLatency(qint64 latencyUs);
+	static QByteArray Serialize(const ChangeNotification& notification);
+	static QByteArray Serialize(const CChangeCoalescer::Batch& batch);
+
+private:
+	// Replaced by Configure() and the destructor, read by everything else
+	mutable QReadWriteLock m_shardsLock;
+	QVector<CSenderShard*> m_shards;
+	QElapsedTimer m_clock;
+
+	// Subscribers with their shard and context, and the indexes used to select recipients
+	mutable QMutex m_subscriberMutex;
+	QHash<qint64, Subscriber> m_subscribers;
+	SubscriberIndex m_tenantIndex;       // tenant and collection; empty tenant: all tenants, empty collection: all collections
+	SubscriberIndex m_collectionIndex;   // collection only, for notifications shared by all tenants
+
+	std::atomic<qint64> m_nextSubscriberId;
+	std::atomic<qint64> m_publishedCount;
+	std::atomic<qint64> m_deliveredCount;
+
+	// Send queue limits, read by the sender threads
+	std::atomic<int> m_maxQueuedNotifications;
+	std::atomic<int> m_maxBytesInFlight;
+	std::atomic<int> m_slowConsumerPolicy;
+
+	std::atomic<int> m_queueHighWaterMark;
+	std::atomic<qint64> m_droppedCount;
+	std::atomic<qint64> m_resyncCount;
+	std::atomic<qint64> m_disconnectedCount;
+
+	// Keep-alive settings, read by the sender threads
+	std::atomic<int> m_heartbeatIntervalMs;
+	std::atomic<int> m_idleTimeoutMs;
+
+	std::atomic<qint64> m_heartbeatCount;
+	std::atomic<qint64> m_idleClosedCount;
+	std::atomic<qint64> m_expiredSessionCount;
+	std::atomic<qint64> m_maxTimerTickUs;
+
+	CChangeCoalescer m_coalescer;
+
+	// Ring of the most recent batch latencies
+	mutable QMutex m_latencyMutex;
+	QVector<qint64> m_latencySamplesUs;
+	int m_nextLatencySample;
+};
+
+
+} // namespace AuthServerSdk
+
+
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#include <AuthServerSdk/CTimerWheel.h>
+
+
+namespace AuthServerSdk
+{
+
+
+static const int s_firstLevelBits = 8;
+static const int s_upperLevelBits = 6;
+static const int s_levelCount = 4;
+
+
+static int GetLevelShift(int level)
+{
+	return (level == 0) ? 0 : s_firstLevelBits + (level - 1) * s_upperLevelBits;
+}
+
+
+static int GetSlotCount(int level)
+{
+	return (level == 0) ? (1 << s_firstLevelBits) : (1 << s_upperLevelBits);
+}
+
+
+// public methods
+
+CTimerWheel::CTimerWheel(int tickMs)
+	:m_tickMs(qMax(1, tickMs)),
+	m_currentTick(0)
+{
+	m_levels.resize(s_levelCount);
+	for (int level = 0; level < s_levelCount; ++level){
+		m_levels[level].resize(GetSlotCount(level));
+	}
+}
+
+
+void CTimerWheel::Schedule(qint64 timerId, qint64 expirationMs)
+{
+	Cancel(timerId);
+
+	Entry entry;
+	entry.expirationTick = qMax(m_currentTick, (expirationMs + m_tickMs - 1) / m_tickMs);
+
+	Insert(timerId, entry);
+}
+
+
+void CTimerWheel::Cancel(qint64 timerId)
+{
+	QHash<qint64, Entry>::iterator entryIter = m_entries.find(timerId);
+	if (entryIter == m_entries.end()){
+		return;
+	}
+
+	m_levels[entryIter->level][entryIter->slot].remove(timerId);
+	m_entries.erase(entryIter);
+}
+
+
+QVector<qint64> CTimerWheel::Advance(qint64 nowMs)
+{
+	QVector<qint64> expiredIds;
+
+	const qint64 targetTick = nowMs / m_tickMs;
+	while (m_currentTick <= targetTick){
+		const int slot = int(m_currentTick & (GetSlotCount(0) - 1));
+
+		// Every full turn of a level brings the next slot of the level above down
+		if (slot == 0){
+			for (int level = 1; level < s_levelCount; ++level){
+				Cascade(level);
+
+				if (((m_currentTick >> GetLevelShift(level)) & (GetSlotCount(level) - 1)) != 0){
+					break;
+				}
+			}
+		}
+
+		QSet<qint64> expiredSlot;
+		expiredSlot.swap(m_levels[0][slot]);
+		for (qint64 timerId : expiredSlot){
+			m_entries.remove(timerId);
+			expiredIds.append(timerId);
+		}
+
+		++m_currentTick;
+	}
+
+	return expiredIds;
+}
+
+
+int CTimerWheel::GetCount() const
+{
+	return m_entries.size();
+}
+
+
+int CTimerWheel::GetTickMs() const
+{
+	return m_tickMs;
+}
+
+
+// private methods
+
+void CTimerWheel::Insert(qint64 timerId, Entry& entry)
+{
+	const qint64 delta = entry.expirationTick - m_currentTick;
+
+	int level = 0;
+	while (level < s_levelCount - 1 && delta >= (qint64(1) << GetLevelShift(level + 1))){
+		++level;
+	}
+
+	qint64 slotTick = entry.expirationTick;
+	if (level == s_levelCount - 1){
+		// Beyond the top level: expire at its end, the owner reschedules
+		const qint64 maxDelta = (qint64(1) << (GetLevelShift(level) + s_upperLevelBits)) - 1;
+		slotTick = m_currentTick + qMin(delta, maxDelta);
+		entry.expirationTick = slotTick;
+	}
+
+	entry.level = level;
+	entry.slot = int((slotTick >> GetLevelShift(level)) & (GetSlotCount(level) - 1));
+
+	m_levels[level][entry.slot].insert(timerId);
+	m_entries.insert(timerId, entry);
+}
+
+
+void CTimerWheel::Cascade(int level)
+{
+	const int slot = int((m_currentTick >> GetLevelShift(level)) & (GetSlotCount(level) - 1));
+
+	QSet<qint64> timerIds;
+	timerIds.swap(m_levels[level][slot]);
+
+	for (qint64 timerId : timerIds){
+		Entry entry = m_entries.value(timerId);
+		Insert(timerId, entry);
+	}
+}
+
+
+} // namespace AuthServerSdk
+
+
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: LicenseRef-Puma-Commercial
+#pragma once
+
+
+// Qt includes
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+
+
+namespace AuthServerSdk
+{
+
+
+/**
+* @brief Hierarchical timer wheel for large numbers of coarse timers.
+*
+* Time is divided into ticks. The first level has one slot per tick for
+* the next 256 ticks, each further level has 64 slots covering 64 slots of
+* the level below. Scheduling and cancelling a timer only touch one slot;
+* advancing by a tick processes the slot of that tick and, every 256
+* ticks, moves the timers of one upper-level slot down. Timers further away
+* than the top level can cover expire at its end and are expected to be
+* rescheduled by the owner.
+*
+* With a tick of 100 ms the levels cover 25.6 seconds, 27 minutes, 29 hours
+* and 77 days.
+*
+* @note Not thread-safe; each sender thread owns its own wheel.
+* @note The wheel is internal to the SDK and is not exported.
+*/
+class CTimerWheel
+{
+public:
+	explicit CTimerWheel(int tickMs);
+
+	/**
+	* @brief Schedules or reschedules a timer to expire at the given time.
+	*
+	* Times are in milliseconds on the same clock as passed to Advance().
+	* Times in the past expire on the next Advance().
+	*/
+	void Schedule(qint64 timerId, qint64 expirationMs);
+
+	void Cancel(qint64 timerId);
+
+	/**
+	* @brief Processes all ticks up to the given time.
+	* @return IDs of the expired timers; they are no longer scheduled.
+	*/
+	QVector<qint64> Advance(qint64 nowMs);
+
+	int GetCount() const;
+
+	int GetTickMs() const;
+
+private:
+	struct Entry
+	{
+		qint64 expirationTick = 0;
+		int level = 0;
+		int slot = 0;
+	};
+
+	void Insert(qint64 timerId, Entry& entry);
+	void Cascade(int level);
+
+private:
+	int m_tickMs;
+
+	// Next tick to be processed
+	qint64 m_currentTick;
+
+	QVector<QVector<QSet<qint64>>> m_levels;
+	QHash<qint64, Entry> m_entries;
+};
+
+
+} // namespace AuthServerSdk
+
+
@@ -2,9 +2,21 @@
 #include "CAuthServerLifecycleTest.h"
 
 
+// Qt includes
+#include <QtCore/QBuffer>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtNetwork/QTcpSocket>
+#include <QtWebSockets/QWebSocket>
+#include <QtWebSockets/QWebSocketServer>
+
 // ACF includes
 #include <itest/CStandardTestExecutor.h>
 
+// Puma includes
+#include <AuthServerSdk/CJsonStreamWriter.h>
+
 
 void CAuthServerLifecycleTest::StartStopRestartTest()
 {
@@ -32,6 +44,71 @@ void CAuthServerLifecycleTest::StartStopRestartTest()
 }
 
 
+void CAuthServerLifecycleTest::DrainStopTest()
+{
+	qDebug() << "=== [DrainStopTest] ===";
+
+	AuthServerSdk::CAuthorizableServer server;
+
+	AuthServerSdk::ServerConfig config;
+	config.wsPort = 8893;
+	config.httpPort = 7782;
+
+	QVERIFY2(server.Start(config), "Start() failed");
+
+	QVERIFY2(server.BeginRequest(), "Request was refused by a running server");
+	QCOMPARE(server.GetStatistics().activeRequests, 1);
+
+	// The request finishes while Stop() keeps the event loop running
+	QTimer::singleShot(200, [&server](){
+		server.EndRequest();
+	});
+
+	QElapsedTimer stopTimer;
+	stopTimer.start();
+	QVERIFY2(server.Stop(5000), "Draining Stop() failed");
+
+	QVERIFY2(stopTimer.elapsed() >= 150, "Stop() did not wait for the running request");
+	QVERIFY2(stopTimer.elapsed() < 5000, "Stop() waited for the full drain timeout");
+	QCOMPARE(server.GetStatistics().activeRequests, 0);
+
+	QVERIFY2(!server.BeginRequest(), "Request was accepted by a stopped server");
+
+	config.wsPort = 8894;
+	config.httpPort = 7783;
+
+	QVERIFY2(server.Start(config), "Restart after a draining Stop() failed");
+	QVERIFY(server.BeginRequest());
+	server.EndRequest();
+
+	QVERIFY(server.Stop());
+}
+
+
+void CAuthServerLifecycleTest::StartFailureCleanupTest()
+{
+	qDebug() << "=== [StartFailureCleanupTest] ===";
+
+	AuthServerSdk::CAuthorizableServer server;
+
+	AuthServerSdk::ServerConfig config;
+	config.wsPort = 8896;
+	config.httpPort = 7785;
+
+	// The metrics endpoint starts after the listeners and cannot bind the HTTP port
+	config.metricsPort = config.httpPort;
+
+	QVERIFY2(!server.Start(config), "Start() with a metrics port in use succeeded");
+	QVERIFY2(!server.BeginRequest(), "Request was admitted after a failed Start()");
+
+	// The failed call has closed the listeners it opened
+	config.metricsPort = 0;
+
+	QVERIFY2(server.Start(config), "Start() on the ports of a failed Start() failed");
+	QVERIFY(server.Stop());
+}
+
+
 void CAuthServerLifecycleTest::SetFeaturesFilePathMissingFileTest()
 {
 	qDebug() << "=== [SetFeaturesFilePathMissingFileTest] ===";
@@ -42,4 +119,469 @@ void CAuthServerLifecycleTest::SetFeaturesFilePathMissingFileTest()
 }
 
 
+void CAuthServerLifecycleTest::ReloadSslMissingFilesTest()
+{
+	qDebug() << "=== [ReloadSslMissingFilesTest] ===";
+
+	AuthServerSdk::CAuthorizableServer server;
+
+	AuthServerSdk::SslConfig sslConfig;
+	QVERIFY2(!server.ReloadSsl(sslConfig), "ReloadSsl() unexpectedly succeeded without certificate paths");
+
+	sslConfig.localCertificatePath = "Z:/definitely/does/not/exist/server.crt";
+	sslConfig.privateKeyPath = "Z:/definitely/does/not/exist/server.key";
+	QVERIFY2(!server.ReloadSsl(sslConfig), "ReloadSsl() unexpectedly succeeded for nonexistent files");
+}
+
+
+void CAuthServerLifecycleTest::RateLimitTest()
+{
+	qDebug() << "=== [RateLimitTest] ===";
+
+	AuthServerSdk::CAuthorizableServer server;
+
+	AuthServerSdk::ServerConfig config;
+	config.wsPort = 8895;
+	config.httpPort = 7784;
+	config.rateLimit.enabled = true;
+	config.rateLimit.expensiveBurst = 2;
+	config.rateLimit.expensiveRequestsPerSecond = 0.001;
+
+	QVERIFY2(server.Start(config), "Start() with rate limiting failed");
+
+	const QList<QByteArray> firstClient = {"user:first", "ip:127.0.0.1"};
+	const QList<QByteArray> secondClient = {"user:second", "ip:127.0.0.2"};
+
+	QVERIFY(server.AdmitRequest(firstClient, AuthServerSdk::RequestCost::Expensive));
+	QVERIFY(server.AdmitRequest(firstClient, AuthServerSdk::RequestCost::Expensive));
+	QVERIFY2(!server.AdmitRequest(firstClient, AuthServerSdk::RequestCost::Expensive), "Burst of expensive requests was not limited");
+
+	// Budgets are per key and per cost class
+	QVERIFY(server.AdmitRequest(secondClient, AuthServerSdk::RequestCost::Expensive));
+	QVERIFY(server.AdmitRequest(firstClient, AuthServerSdk::RequestCost::Cheap));
+
+	AuthServerSdk::ServerStatistics statistics = server.GetStatistics();
+	QCOMPARE(statistics.admittedRequests, qint64(4));
+	QCOMPARE(statistics.rateLimitedRequests, qint64(1));
+
+	QVERIFY(server.Stop());
+}
+
+
+void CAuthServerLifecycleTest::JsonStreamWriterChunkTest()
+{
+	qDebug() << "=== [JsonStreamWriterChunkTest] ===";
+
+	const int flushThreshold = 1024;
+	const int elementCount = 500;
+
+	QBuffer buffer;
+	QVERIFY(buffer.open(QIODevice::WriteOnly));
+
+	AuthServerSdk::CJsonStreamWriter writer(&buffer, flushThreshold);
+	QVERIFY(writer.WriteHeader(200));
+	QVERIFY(writer.BeginArray("{\"data\":{\"UsersList\":{\"items\":["));
+
+	QByteArray expectedBody = "{\"data\":{\"UsersList\":{\"items\":[";
+	for (int index = 0; index < elementCount; ++index){
+		QByteArray element = "{\"id\":\"" + QByteArray::number(index) + "\",\"name\":\"User\"}";
+		if (index > 0){
+			expectedBody += ',';
+		}
+		expectedBody += element;
+
+		QVERIFY(writer.WriteRawElement(element));
+	}
+	expectedBody += "]}}}";
+
+	QVERIFY(writer.EndArray("]}}}"));
+	QCOMPARE(writer.GetElementCount(), qint64(elementCount));
+	QCOMPARE(writer.GetBodySize(), qint64(expectedBody.size()));
+
+	const QByteArray response = buffer.data();
+	const int headerEnd = response.indexOf("\r\n\r\n");
+	QVERIFY(headerEnd > 0);
+	QVERIFY(response.startsWith("HTTP/1.1 200 OK\r\n"));
+	QVERIFY(response.left(headerEnd).contains("Transfer-Encoding: chunked"));
+
+	// Decode the chunked body and check the size of every chunk
+	QByteArray decodedBody;
+	int chunkCount = 0;
+	int position = headerEnd + 4;
+	for (;;){
+		const int sizeEnd = response.indexOf("\r\n", position);
+		QVERIFY2(sizeEnd > position, "Chunk size line is missing");
+
+		bool isNumber = false;
+		const int chunkSize = response.mid(position, sizeEnd - position).toInt(&isNumber, 16);
+		QVERIFY(isNumber);
+
+		position = sizeEnd + 2;
+		if (chunkSize == 0){
+			break;
+		}
+
+		QVERIFY2(chunkSize < 2 * flushThreshold, "Chunk exceeds the flush threshold by more than one element");
+		QCOMPARE(response.mid(position + chunkSize, 2), QByteArray("\r\n"));
+
+		decodedBody += response.mid(position, chunkSize);
+		position += chunkSize + 2;
+		chunkCount++;
+	}
+
+	QCOMPARE(response.mid(position), QByteArray("\r\n"));
+	QVERIFY2(chunkCount > 1, "Body was not split into chunks");
+	QCOMPARE(decodedBody, expectedBody);
+}
+
+
+void CAuthServerLifecycleTest::SubscriberHeartbeatLoadTest()
+{
+	qDebug() << "=== [SubscriberHeartbeatLoadTest] ===";
+
+	// PUMATEST_SUBSCRIBERS raises the count for a load run on one node; the
+	// open file limit has to allow two sockets per subscriber
+	int subscriberCount = qEnvironmentVariableIntValue("PUMATEST_SUBSCRIBERS");
+	if (subscriberCount <= 0){
+		subscriberCount = 500;
+	}
+
+	AuthServerSdk::CAuthorizableServer server;
+
+	AuthServerSdk::ServerConfig config;
+	config.wsPort = 8897;
+	config.httpPort = 7786;
+	config.notifications.heartbeatIntervalMs = 300;
+	config.notifications.idleTimeoutMs = 5000;
+
+	QVERIFY2(server.Start(config), "Start() failed");
+
+	// Accepting side of the subscriber connections
+	QWebSocketServer socketServer("pumatest", QWebSocketServer::NonSecureMode);
+	QVERIFY(socketServer.listen(QHostAddress::LocalHost));
+
+	// Every second subscriber has a session that expires during the test
+	const QDateTime sessionExpiration = QDateTime::currentDateTimeUtc().addMSecs(2000);
+	int attachedCount = 0;
+	QObject::connect(&socketServer, &QWebSocketServer::newConnection, &socketServer, [&](){
+		while (socketServer.hasPendingConnections()){
+			AuthServerSdk::SubscriberContext context;
+			if (attachedCount % 2 == 0){
+				context.sessionExpiration = sessionExpiration;
+			}
+
+			if (server.AttachSubscriber(socketServer.nextPendingConnection(), context) >= 0){
+				++attachedCount;
+			}
+		}
+	});
+
+	// Clients answer the pings automatically while the event loop runs
+	QObject clientOwner;
+	const QUrl url(QString("ws://127.0.0.1:%1").arg(socketServer.serverPort()));
+	for (int index = 0; index < subscriberCount; ++index){
+		QWebSocket* clientPtr = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, &clientOwner);
+		clientPtr->open(url);
+	}
+
+	QTRY_COMPARE_WITH_TIMEOUT(attachedCount, subscriberCount, 60000);
+
+	const int expiringCount = (subscriberCount + 1) / 2;
+	QTRY_COMPARE_WITH_TIMEOUT(server.GetStatistics().expiredSubscriberSessions, qint64(expiringCount), 10000);
+	QTRY_VERIFY_WITH_TIMEOUT(server.GetStatistics().heartbeatsSent >= qint64(subscriberCount), 10000);
+
+	const AuthServerSdk::ServerStatistics statistics = server.GetStatistics();
+	qDebug() << "Subscribers:" << subscriberCount << "heartbeats:" << statistics.heartbeatsSent << "longest tick:" << statistics.maxTimerTickMs << "ms";
+
+	QCOMPARE(statistics.idleSubscribersClosed, qint64(0));
+	QCOMPARE(statistics.subscribers, subscriberCount - expiringCount);
+	QVERIFY2(statistics.maxTimerTickMs < 100.0, "A timer tick took longer than the tick interval");
+
+	QVERIFY(server.Stop());
+}
+
+
+void CAuthServerLifecycleTest::SubscriberTenantIsolationTest()
+{
+	qDebug() << "=== [SubscriberTenantIsolationTest] ===";
+
+	AuthServerSdk::CAuthorizableServer server;
+
+	AuthServerSdk::ServerConfig config;
+	config.wsPort = 8910;
+	config.httpPort = 7799;
+	config.notifications.senderThreads = 1;
+
+	QVERIFY2(server.Start(config), "Start() failed");
+
+	QWebSocketServer socketServer("pumatest", QWebSocketServer::NonSecureMode);
+	QVERIFY(socketServer.listen(QHostAddress::LocalHost));
+
+	// Subscribers are attached one after another with these contexts
+	QList<AuthServerSdk::SubscriberContext> contexts;
+	contexts.append(AuthServerSdk::SubscriberContext());
+
+	AuthServerSdk::SubscriberContext ownTenantContext;
+	ownTenantContext.tenantId = "tenantA";
+	contexts.append(ownTenantContext);
+
+	AuthServerSdk::SubscriberContext allTenantsContext;
+	allTenantsContext.allTenants = true;
+	contexts.append(allTenantsContext);
+
+	int attachedCount = 0;
+	QObject::connect(&socketServer, &QWebSocketServer::newConnection, &socketServer, [&](){
+		while (socketServer.hasPendingConnections()){
+			if (server.AttachSubscriber(socketServer.nextPendingConnection(), contexts.value(attachedCount)) >= 0){
+				++attachedCount;
+			}
+		}
+	});
+
+	QObject clientOwner;
+	QList<QByteArrayList> receivedMessages;
+	const QUrl url(QString("ws://127.0.0.1:%1").arg(socketServer.serverPort()));
+	for (int index = 0; index < contexts.size(); ++index){
+		receivedMessages.append(QByteArrayList());
+
+		QWebSocket* clientPtr = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, &clientOwner);
+		QObject::connect(clientPtr, &QWebSocket::binaryMessageReceived, clientPtr, [&receivedMessages, index](const QByteArray& message){
+			receivedMessages[index].append(message);
+		});
+		clientPtr->open(url);
+
+		QTRY_COMPARE(attachedCount, index + 1);
+	}
+
+	AuthServerSdk::ChangeNotification otherTenantChange;
+	otherTenantChange.collectionId = "Users";
+	otherTenantChange.objectId = "otherTenantUser";
+	otherTenantChange.operation = "Updated";
+	otherTenantChange.tenantId = "tenantB";
+	server.PublishChange(otherTenantChange);
+
+	AuthServerSdk::ChangeNotification sharedChange;
+	sharedChange.collectionId = "Roles";
+	sharedChange.objectId = "sharedRole";
+	sharedChange.operation = "Updated";
+	server.PublishChange(sharedChange);
+
+	// Delivery keeps the publishing order, so the shared change arrives last
+	QTRY_COMPARE(receivedMessages[0].size(), 1);
+	QTRY_COMPARE(receivedMessages[1].size(), 1);
+	QTRY_COMPARE(receivedMessages[2].size(), 2);
+
+	QVERIFY2(receivedMessages[0].first().contains("sharedRole"), "A subscriber without tenant received another tenant's change");
+	QVERIFY2(receivedMessages[1].first().contains("sharedRole"), "A subscriber of tenantA received a change of tenantB");
+	QVERIFY(receivedMessages[2].first().contains("otherTenantUser"));
+
+	QVERIFY(server.Stop());
+}
+
+
+void CAuthServerLifecycleTest::SlowSubscriberDisconnectTest()
+{
+	qDebug() << "=== [SlowSubscriberDisconnectTest] ===";
+
+	AuthServerSdk::CAuthorizableServer server;
+
+	AuthServerSdk::ServerConfig config;
+	config.wsPort = 8911;
+	config.httpPort = 7800;
+	config.notifications.senderThreads = 1;
+	config.notifications.maxQueuedNotifications = 8;
+	config.notifications.slowConsumerPolicy = AuthServerSdk::SlowConsumerPolicy::Disconnect;
+
+	QVERIFY2(server.Start(config), "Start() failed");
+
+	QWebSocketServer socketServer("pumatest", QWebSocketServer::NonSecureMode);
+	QVERIFY(socketServer.listen(QHostAddress::LocalHost));
+
+	int attachedCount = 0;
+	QObject::connect(&socketServer, &QWebSocketServer::newConnection, &socketServer, [&](){
+		while (socketServer.hasPendingConnections()){
+			if (server.AttachSubscriber(socketServer.nextPendingConnection(), AuthServerSdk::SubscriberContext()) >= 0){
+				++attachedCount;
+			}
+		}
+	});
+
+	// Plain TCP client that completes the handshake and then stops reading
+	QTcpSocket client;
+	client.connectToHost(QHostAddress::LocalHost, socketServer.serverPort());
+	QVERIFY(client.waitForConnected(5000));
+	client.write(
+				"GET / HTTP/1.1\r\n"
+				"Host: 127.0.0.1\r\n"
+				"Upgrade: websocket\r\n"
+				"Connection: Upgrade\r\n"
+				"Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+				"Sec-WebSocket-Version: 13\r\n"
+				"\r\n");
+
+	QByteArray handshakeResponse;
+	QTRY_VERIFY((handshakeResponse += client.readAll()).contains("\r\n\r\n"));
+	QVERIFY(handshakeResponse.startsWith("HTTP/1.1 101"));
+	QTRY_COMPARE(attachedCount, 1);
+
+	// Once the client buffer is full the kernel buffers fill up and the server socket keeps its bytes
+	client.setReadBufferSize(1);
+
+	AuthServerSdk::ChangeNotification notification;
+	notification.collectionId = "Users";
+	notification.operation = "Updated";
+	for (int index = 0; index < 256; ++index){
+		notification.objectId = QByteArray::number(index) + QByteArray(128 * 1024, 'x');
+		server.PublishChange(notification);
+	}
+
+	QTRY_COMPARE_WITH_TIMEOUT(server.GetStatistics().disconnectedSlowSubscribers, qint64(1), 10000);
+	QTRY_COMPARE(server.GetStatistics().subscribers, 0);
+
+	const AuthServerSdk::ServerStatistics statistics = server.GetStatistics();
+	QVERIFY2(statistics.droppedNotifications > 0, "Queued notifications of the disconnected subscriber were not counted");
+	QVERIFY(statistics.deliveredNotifications < 256);
+	QVERIFY(statistics.subscriberQueueHighWaterMark <= config.notifications.maxQueuedNotifications);
+
+	QVERIFY(server.Stop());
+}
+
+
+void CAuthServerLifecycleTest::SubscriberCoalescingTest()
+{
+	qDebug() << "=== [SubscriberCoalescingTest] ===";
+
+	AuthServerSdk::CAuthorizableServer server;
+
+	AuthServerSdk::ServerConfig config;
+	config.wsPort = 8912;
+	config.httpPort = 7801;
+	config.notifications.senderThreads = 1;
+	config.notifications.coalescingWindowMs = 200;
+	config.notifications.maxCoalescingDelayMs = 5000;
+
+	QVERIFY2(server.Start(config), "Start() failed");
+
+	QWebSocketServer socketServer("pumatest", QWebSocketServer::NonSecureMode);
+	QVERIFY(socketServer.listen(QHostAddress::LocalHost));
+
+	int attachedCount = 0;
+	QObject::connect(&socketServer, &QWebSocketServer::newConnection, &socketServer, [&](){
+		while (socketServer.hasPendingConnections()){
+			if (server.AttachSubscriber(socketServer.nextPendingConnection(), AuthServerSdk::SubscriberContext()) >= 0){
+				++attachedCount;
+			}
+		}
+	});
+
+	QByteArrayList receivedMessages;
+	QWebSocket client;
+	QObject::connect(&client, &QWebSocket::binaryMessageReceived, &client, [&receivedMessages](const QByteArray& message){
+		receivedMessages.append(message);
+	});
+	client.open(QUrl(QString("ws://127.0.0.1:%1").arg(socketServer.serverPort())));
+	QTRY_COMPARE(attachedCount, 1);
+
+	// A burst within the window: three roles, the first one changed twice, and one group
+	auto publish = [&server](const QByteArray& collectionId, const QByteArray& objectId, const QByteArray& operation){
+		AuthServerSdk::ChangeNotification notification;
+		notification.collectionId = collectionId;
+		notification.objectId = objectId;
+		notification.operation = operation;
+		server.PublishChange(notification);
+	};
+
+	publish("Roles", "r1", "Updated");
+	publish("Roles", "r2", "Updated");
+	publish("Roles", "r1", "Removed");
+	publish("Roles", "r3", "Inserted");
+	publish("Groups", "g1", "Updated");
+
+	QTRY_COMPARE(receivedMessages.size(), 2);
+
+	// Batches of different collections are independent, so their order is not fixed
+	QJsonObject rolesMessage;
+	QJsonObject groupsMessage;
+	for (const QByteArray& message : receivedMessages){
+		const QJsonObject object = QJsonDocument::fromJson(message).object();
+		if (object.value("collectionId").toString() == "Roles"){
+			rolesMessage = object;
+		}
+		else{
+			groupsMessage = object;
+		}
+	}
+
+	QCOMPARE(rolesMessage.value("type").toString(), QString("changes"));
+	const QJsonArray changes = rolesMessage.value("changes").toArray();
+	QCOMPARE(changes.size(), 3);
+	QCOMPARE(changes[0].toObject().value("objectId").toString(), QString("r1"));
+	QCOMPARE(changes[0].toObject().value("operation").toString(), QString("Removed"));
+	QCOMPARE(changes[1].toObject().value("objectId").toString(), QString("r2"));
+	QCOMPARE(changes[2].toObject().value("objectId").toString(), QString("r3"));
+
+	// A batch with one object keeps the format of a single change
+	QCOMPARE(groupsMessage.value("type").toString(), QString("change"));
+	QCOMPARE(groupsMessage.value("objectId").toString(), QString("g1"));
+
+	const AuthServerSdk::ServerStatistics statistics = server.GetStatistics();
+	QCOMPARE(statistics.publishedChanges, qint64(5));
+	QCOMPARE(statistics.coalescedChanges, qint64(3));
+	QCOMPARE(statistics.deliveredNotifications, qint64(2));
+
+	QVERIFY(server.Stop());
+}
+
+
+void CAuthServerLifecycleTest::DatabaseExecutorDeadlineTest()
+{
+	qDebug() << "=== [DatabaseExecutorDeadlineTest] ===";
+
+	AuthServerSdk::CAuthorizableServer server;
+
+	AuthServerSdk::ServerConfig config;
+	config.wsPort = 8898;
+	config.httpPort = 7787;
+	config.databaseExecutor.threads = 1;
+
+	QVERIFY2(server.Start(config), "Start() failed");
+
+	QList<AuthServerSdk::DatabaseTaskStatus> statuses;
+	QThread* callbackThreadPtr = nullptr;
+	bool isShortTaskRun = false;
+
+	// Occupies the only database thread
+	QVERIFY(server.ExecuteDatabaseTask(
+				[](const QDeadlineTimer&){ QThread::msleep(300); },
+				this,
+				[&](AuthServerSdk::DatabaseTaskStatus status){
+					statuses.append(status);
+					callbackThreadPtr = QThread::currentThread();
+				},
+				5000));
+
+	// Its deadline passes while it waits for the slow task
+	QVERIFY(server.ExecuteDatabaseTask(
+				[&isShortTaskRun](const QDeadlineTimer&){ isShortTaskRun = true; },
+				this,
+				[&statuses](AuthServerSdk::DatabaseTaskStatus status){ statuses.append(status); },
+				50));
+
+	QTRY_COMPARE(statuses.size(), 2);
+	QCOMPARE(statuses[0], AuthServerSdk::DatabaseTaskStatus::Completed);
+	QCOMPARE(statuses[1], AuthServerSdk::DatabaseTaskStatus::DeadlineExceeded);
+	QVERIFY(!isShortTaskRun);
+
+	// The handler resumes in its own thread, not in the database thread
+	QCOMPARE(callbackThreadPtr, QThread::currentThread());
+
+	const AuthServerSdk::ServerStatistics statistics = server.GetStatistics();
+	QCOMPARE(statistics.databaseThreads, 1);
+	QCOMPARE(statistics.completedDatabaseTasks, qint64(1));
+	QCOMPARE(statistics.expiredDatabaseTasks, qint64(1));
+
+	QVERIFY(server.Stop());
+}
+
+
 I_ADD_TEST(CAuthServerLifecycleTest);
@@ -32,5 +32,15 @@ class CAuthServerLifecycleTest: public QObject
 	Q_OBJECT
 private slots:
 	void StartStopRestartTest();
+	void DrainStopTest();
+	void StartFailureCleanupTest();
 	void SetFeaturesFilePathMissingFileTest();
+	void ReloadSslMissingFilesTest();
+	void RateLimitTest();
+	void JsonStreamWriterChunkTest();
+	void SubscriberHeartbeatLoadTest();
+	void SubscriberTenantIsolationTest();
+	void SlowSubscriberDisconnectTest();
+	void SubscriberCoalescingTest();
+	void DatabaseExecutorDeadlineTest();
 };
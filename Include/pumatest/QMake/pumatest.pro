@@ -15,4 +15,4 @@ LIBS += -L$(ACFDIR)/Lib/$$COMPILER_DIR -litest
 LIBS += -L$(ACFSLNDIR)/Lib/$$COMPILER_DIR -litest -liauth -liservice -lifile -liser
 LIBS += -L$(IMTCOREDIR)/Lib/$$COMPILER_DIR -limtbase -limtauth -limtcrypt -limtservergql -limtdb -limtgql -limtgqltest -limtauthgql -limtbasesdl -limtauthsdl -limtcol
 
-QT += xml test sql widgets core
+QT += xml test sql widgets core network websockets